@@ -0,0 +1,55 @@
+#ifndef ARENA_H
+#define ARENA_H
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for objects that all die together, such as the nodes of a
+// parsed program. Memory comes from large blocks released in one go when the
+// arena is destroyed; only objects whose destructor does real work are
+// destroyed one by one, in reverse order of creation.
+class Arena
+{
+    static constexpr std::size_t BLOCK_SIZE = 64 * 1024;
+
+    struct Destructor
+    {
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    std::pmr::monotonic_buffer_resource blocks{BLOCK_SIZE};
+    std::vector<Destructor> destructors;
+
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena()
+    {
+        for(auto it = destructors.rbegin(); it != destructors.rend(); ++it)
+            it->destroy(it->object);
+    }
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args)
+    {
+        auto obj = new (blocks.allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+            destructors.push_back({ [](void* p) { static_cast<T*>(p)->~T(); }, obj });
+        return obj;
+    }
+
+    template<typename T>
+    T* make_array(const std::size_t size)
+    {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return static_cast<T*>(blocks.allocate(size * sizeof(T), alignof(T)));
+    }
+};
+
+#endif // ARENA_H
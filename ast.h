@@ -1,12 +1,40 @@
 #ifndef AST_H
 #define AST_H
 #include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include "arena.h"
+#include "gc.h"
+#include "symbol_table.h"
 #include "token.h"
 
+namespace obj {
+class String;
+}
+
 namespace ast {
+// In the same order as the VM's arithmetic and comparison opcodes.
+enum class Operator {
+    PLUS,
+    MINUS,
+    MULTIPLICATION,
+    DIVISION,
+    EQ,
+    NOT_EQ,
+    LT,
+    GT,
+    NEGATION
+};
+
 enum class Node {
+    ArrayLiteral,
     AssignStatement,
     Block,
     Boolean,
@@ -14,8 +42,10 @@ enum class Node {
     Expression,
     ExpressionStatement,
     Function,
+    HashLiteral,
     Identifier,
     If,
+    Index,
     Infix,
     Integer,
     LetStatement,
@@ -24,16 +54,21 @@ enum class Node {
     Program,
     ReturnStatement,
     Statement,
-    StringLiteral
+    StringLiteral,
+    While
 };
 
+// Nodes live in the Arena of the program that owns the tree and are never
+// deleted one by one, so the destructor is neither virtual nor public.
 class ASTNode
 {
+protected:
+    ~ASTNode() = default;
+
 public:
     virtual std::string token_literal() const = 0;
     virtual std::string to_string() const = 0;
     virtual Node type() const = 0;
-    virtual ~ASTNode(){}
     ASTNode() = default;
     ASTNode (const ASTNode&) = delete;
     ASTNode& operator=(const ASTNode&) = delete;
@@ -41,13 +76,53 @@ public:
     ASTNode& operator=(ASTNode&&) = delete;
 };
 
+// Children of a node, stored in the same Arena as the node itself.
+template<typename T>
+class NodeList
+{
+    T** items = nullptr;
+    std::size_t count = 0;
+
+public:
+    NodeList() = default;
+    NodeList(T** items, const std::size_t count) : items(items), count(count) {}
+
+    template<typename Iterator>
+    static NodeList copy(Arena& arena, Iterator first, Iterator last)
+    {
+        auto count = static_cast<std::size_t>(std::distance(first, last));
+        auto items = arena.make_array<T*>(count);
+        for(std::size_t i = 0; first != last; ++first, ++i)
+            items[i] = static_cast<T*>(*first);
+        return NodeList(items, count);
+    }
+
+    static NodeList copy(Arena& arena, std::initializer_list<T*> nodes)
+    {
+        return copy(arena, nodes.begin(), nodes.end());
+    }
+
+    T** begin() const { return items; }
+    T** end() const { return items + count; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T* operator[](const std::size_t i) const { return items[i]; }
+
+    T* at(const std::size_t i) const
+    {
+        if(i >= count)
+            throw std::out_of_range("NodeList::at");
+        return items[i];
+    }
+};
+
 class Statement : public ASTNode
 {
 public:
     Token token;
     Statement() = default;
     explicit Statement(const Token& t) : token(t) {}
-    std::string token_literal() const override { return token.literal; }
+    std::string token_literal() const override { return std::string(token.literal); }
     Node type() const override { return Node::Statement; }
 };
 
@@ -57,21 +132,33 @@ public:
     Token token;
     Expression() = default;
     explicit Expression(const Token& t) : token(t) {}
-    std::string token_literal() const override { return token.literal; }
-    std::string to_string() const override { return token.literal; }
+    std::string token_literal() const override { return std::string(token.literal); }
+    std::string to_string() const override { return std::string(token.literal); }
     Node type() const override { return Node::Expression; }
 };
 
-class Program : public ASTNode
+class Program final : public ASTNode
 {
     Program() = delete;
     Program(const Program&) = delete;
     Program& operator=(const Program&) = delete;
 
 public:
+    // Text the tokens of the tree point into. Programs that outlive the
+    // caller's buffer are created from their source and parsed from this copy.
+    const std::string source;
+    // Owns the nodes parsed into this program, see Parser(const Lexer&, Arena&).
+    Arena arena;
     std::vector<Statement*> statements;
+    // The objects ConstantFolder made for the literals of the tree. They
+    // live as long as the program instead of on a heap, so evaluating a
+    // literal allocates nothing.
+    std::vector<std::unique_ptr<gc::Collectable>> constants;
 
+    // Takes nodes that live in some other arena, such as the one of a
+    // Parser(const Lexer&), which must outlive the program.
     explicit Program(const std::vector<Statement*>& s) : statements(s) {}
+    explicit Program(std::string src) : source(std::move(src)) {}
     Node type() const override { return Node::Program; }
 
     std::string token_literal() const override
@@ -95,26 +182,25 @@ public:
             return true;
         return false;
     }
-
-    ~Program()
-    {
-        for(auto s : statements)
-            delete s;
-    }
 };
 
 class Identifier : public Expression
 {
 public:
-    const std::string value;
+    const std::string_view value;
+    // filled in by the Resolver, depth counts the scopes to walk outwards
+    Symbol symbol;
+    std::size_t depth = 0;
+    std::size_t slot = 0;
+    bool resolved = false;
     Identifier() = default;
-    Identifier(const Token& t, const std::string& v)
+    Identifier(const Token& t, std::string_view v)
         : Expression(t), value(v) {}
     Node type() const override { return Node::Identifier; }
 
     std::string to_string() const override
     {
-        return value;
+        return std::string(value);
     }
 };
 
@@ -133,14 +219,6 @@ public:
     {
         return token_literal() + " " + name->to_string() + " = " + value->to_string() + ";";
     }
-
-    ~LetStatement()
-    {
-        if(name)
-            delete name;
-        if(value)
-            delete value;
-    }
 };
 
 class ReturnStatement : public Statement
@@ -157,12 +235,6 @@ public:
     {
         return token_literal() + " " + return_value->to_string() + ";";
     }
-
-    ~ReturnStatement()
-    {
-        if(return_value)
-            delete return_value;
-    }
 };
 
 class ExpressionStatement : public Statement
@@ -180,12 +252,6 @@ public:
     {
         return expression->to_string();
     }
-
-    ~ExpressionStatement()
-    {
-        if(expression)
-            delete expression;
-    }
 };
 
 class Integer : public Expression
@@ -197,32 +263,28 @@ public:
         : Expression(t), value(v) {}
     Node type() const override { return Node::Integer; }
 
+    // folded results below zero are stored in two's complement
     std::string to_string() const override
     {
-        return std::to_string(value);
+        return std::to_string(static_cast<std::int64_t>(value));
     }
 };
 
 class Prefix : public Expression
 {
 public:
-    const std::string operatr;
+    const std::string_view operatr;
+    const Operator op;
     Expression* right;
-    Prefix(const Token& t, const std::string& op)
-        : Expression(t), operatr(op), right(nullptr) {}
-    Prefix(const Token& t, const std::string& op, Expression* e)
-        : Expression(t), operatr(op), right(e) {}
+    Prefix(const Token& t, std::string_view operatr, const Operator op)
+        : Expression(t), operatr(operatr), op(op), right(nullptr) {}
+    Prefix(const Token& t, std::string_view operatr, const Operator op, Expression* e)
+        : Expression(t), operatr(operatr), op(op), right(e) {}
     Node type() const override { return Node::Prefix; }
 
     std::string to_string() const override
     {
-        return "(" + operatr + right->to_string() + ")";
-    }
-
-    ~Prefix()
-    {
-        if(right)
-            delete right;
+        return "(" + std::string(operatr) + right->to_string() + ")";
     }
 };
 
@@ -231,23 +293,17 @@ class Infix : public Expression
 public:
     Expression* right;
     Expression* left;
-    const std::string operatr;
-    Infix(const Token& t, Expression* l, const std::string& op)
-        : Expression(t), right(nullptr), left(l), operatr(op) {}
-    Infix(const Token& t, Expression* l, const std::string& op, Expression* r)
-        : Expression(t), right(r), left(l), operatr(op) {}
+    const std::string_view operatr;
+    const Operator op;
+    Infix(const Token& t, Expression* l, std::string_view operatr, const Operator op)
+        : Expression(t), right(nullptr), left(l), operatr(operatr), op(op) {}
+    Infix(const Token& t, Expression* l, std::string_view operatr, const Operator op, Expression* r)
+        : Expression(t), right(r), left(l), operatr(operatr), op(op) {}
     Node type() const override { return Node::Infix; }
 
     std::string to_string() const override
     {
-        return "(" + left->to_string() + " " + operatr + " " + right->to_string() + ")";
-    }
-
-    ~Infix()
-    {
-        if(right)
-            delete right;
-        delete left;
+        return "(" + left->to_string() + " " + std::string(operatr) + " " + right->to_string() + ")";
     }
 };
 
@@ -268,8 +324,8 @@ public:
 class Block : public Statement
 {
 public:
-    std::vector<Statement*> statements;
-    Block(const Token& t, const std::vector<Statement*>& vs)
+    NodeList<Statement> statements;
+    Block(const Token& t, NodeList<Statement> vs)
         : Statement(t), statements(vs) {}
     Node type() const override { return Node::Block; }
 
@@ -280,12 +336,6 @@ public:
             out.append(s->to_string());
         return out;
     }
-
-    ~Block()
-    {
-        for(auto s : statements)
-            delete s;
-    }
 };
 
 class If : public Expression
@@ -309,26 +359,38 @@ public:
             out.append(" si_no" + alternative->to_string());
         return out;
     }
+};
 
-    ~If()
+class While : public Expression
+{
+public:
+    Expression* condition;
+    Block* body;
+    explicit While(const Token& t) : Expression(t), condition(nullptr), body(nullptr) {}
+    While(const Token& t, Expression* cond, Block* b) : Expression(t), condition(cond), body(b) {}
+    Node type() const override { return Node::While; }
+
+    std::string to_string() const override
     {
-        if(condition)
-            delete condition;
-        if(consequence)
-            delete consequence;
-        if(alternative)
-            delete alternative;
+        return "mientras " + condition->to_string() + " " + body->to_string();
     }
 };
 
 class Function : public Expression
 {
 public:
-    std::vector<Identifier*> parameters;
+    NodeList<Identifier> parameters;
     Block* body;
-    explicit Function(const Token& t, const std::vector<Identifier*>& p = {})
+    std::unique_ptr<SymbolTable> symbols;
+    // the variable the function was bound to where it is defined, empty when
+    // it is anonymous; only used to name it in profiles
+    std::string_view name;
+    // set by the Resolver when the body holds a function literal, the only
+    // way the environment of a call can outlive it
+    bool makes_closures = false;
+    explicit Function(const Token& t, NodeList<Identifier> p = {})
         : Expression(t), parameters(p), body(nullptr) {}
-    Function(const Token& t, const std::vector<Identifier*>& p, Block* b)
+    Function(const Token& t, NodeList<Identifier> p, Block* b)
         :   Expression(t), parameters(p), body(b) {}
     Node type() const override { return Node::Function; }
 
@@ -340,23 +402,16 @@ public:
         params.erase(params.size() - 2, 2);
         return token_literal() + "(" + params + ")" + "{" + body->to_string() + "}";
     }
-
-    ~Function()
-    {
-        delete body;
-        for(auto p : parameters)
-            delete p;
-    }
 };
 
 class Call : public Expression
 {
 public:
     Expression* function;
-    std::vector<Expression*> arguments;
+    NodeList<Expression> arguments;
     Call(const Token& t, Expression* f)
         : Expression(t), function(f) {}
-    Call(const Token& t, Expression* f, const std::vector<Expression*>& args)
+    Call(const Token& t, Expression* f, NodeList<Expression> args)
         : Expression(t), function(f), arguments(args) {}
     Node type() const override { return Node::Call; }
 
@@ -368,20 +423,15 @@ public:
         args.erase(args.size() - 2, 2);
         return function->to_string() + "(" + args + ")";
     }
-
-    ~Call()
-    {
-        delete function;
-        for(auto arg : arguments)
-            delete arg;
-    }
 };
 
 class StringLiteral : public Expression
 {
 public:
-    const std::string value;
-    StringLiteral(const Token& t, const std::string& val)
+    const std::string_view value;
+    // the String every evaluation returns, set by ConstantFolder
+    obj::String* object = nullptr;
+    StringLiteral(const Token& t, std::string_view val)
         : Expression(t), value(val) {}
     Node type() const override { return Node::StringLiteral; }
     std::string to_string() const override
@@ -390,6 +440,62 @@ public:
     }
 };
 
+class ArrayLiteral : public Expression
+{
+public:
+    NodeList<Expression> elements;
+    explicit ArrayLiteral(const Token& t, NodeList<Expression> e = {})
+        : Expression(t), elements(e) {}
+    Node type() const override { return Node::ArrayLiteral; }
+
+    std::string to_string() const override
+    {
+        std::string elems;
+        for(auto e : elements)
+            elems.append(e->to_string() + ", ");
+        if(!elems.empty())
+            elems.erase(elems.size() - 2, 2);
+        return "[" + elems + "]";
+    }
+};
+
+// The entries alternate between a key and its value, in source order.
+class HashLiteral : public Expression
+{
+public:
+    NodeList<Expression> entries;
+    explicit HashLiteral(const Token& t, NodeList<Expression> e = {})
+        : Expression(t), entries(e) {}
+    Node type() const override { return Node::HashLiteral; }
+
+    std::string to_string() const override
+    {
+        std::string pairs;
+        for(std::size_t i = 0; i + 1 < entries.size(); i += 2)
+            pairs.append(entries[i]->to_string() + ": " + entries[i + 1]->to_string() + ", ");
+        if(!pairs.empty())
+            pairs.erase(pairs.size() - 2, 2);
+        return "{" + pairs + "}";
+    }
+};
+
+class Index : public Expression
+{
+public:
+    Expression* left;
+    Expression* index;
+    Index(const Token& t, Expression* l)
+        : Expression(t), left(l), index(nullptr) {}
+    Index(const Token& t, Expression* l, Expression* i)
+        : Expression(t), left(l), index(i) {}
+    Node type() const override { return Node::Index; }
+
+    std::string to_string() const override
+    {
+        return "(" + left->to_string() + "[" + index->to_string() + "])";
+    }
+};
+
 class Null : public Expression
 {
 public:
@@ -417,6 +523,65 @@ public:
     }
 };
 
+// Static dispatch over the concrete node types. Derived provides a visit
+// overload for every node it handles (a template overload can catch the
+// rest) and dispatch() picks it from node->type(), without RTTI.
+template<typename Derived, typename Result, typename... Args>
+class Visitor
+{
+public:
+    Result dispatch(ASTNode* node, Args... args)
+    {
+        auto self = static_cast<Derived*>(this);
+
+        switch (node->type()) {
+            case Node::ArrayLiteral:
+                return self->visit(static_cast<ArrayLiteral*>(node), args...);
+            case Node::AssignStatement:
+                return self->visit(static_cast<AssignStatement*>(node), args...);
+            case Node::Block:
+                return self->visit(static_cast<Block*>(node), args...);
+            case Node::Boolean:
+                return self->visit(static_cast<Boolean*>(node), args...);
+            case Node::Call:
+                return self->visit(static_cast<Call*>(node), args...);
+            case Node::ExpressionStatement:
+                return self->visit(static_cast<ExpressionStatement*>(node), args...);
+            case Node::Function:
+                return self->visit(static_cast<Function*>(node), args...);
+            case Node::HashLiteral:
+                return self->visit(static_cast<HashLiteral*>(node), args...);
+            case Node::Identifier:
+                return self->visit(static_cast<Identifier*>(node), args...);
+            case Node::If:
+                return self->visit(static_cast<If*>(node), args...);
+            case Node::Index:
+                return self->visit(static_cast<Index*>(node), args...);
+            case Node::Infix:
+                return self->visit(static_cast<Infix*>(node), args...);
+            case Node::Integer:
+                return self->visit(static_cast<Integer*>(node), args...);
+            case Node::LetStatement:
+                return self->visit(static_cast<LetStatement*>(node), args...);
+            case Node::Null:
+                return self->visit(static_cast<Null*>(node), args...);
+            case Node::Prefix:
+                return self->visit(static_cast<Prefix*>(node), args...);
+            case Node::Program:
+                return self->visit(static_cast<Program*>(node), args...);
+            case Node::ReturnStatement:
+                return self->visit(static_cast<ReturnStatement*>(node), args...);
+            case Node::StringLiteral:
+                return self->visit(static_cast<StringLiteral*>(node), args...);
+            case Node::While:
+                return self->visit(static_cast<While*>(node), args...);
+            default:
+                // Statement and Expression are only base classes
+                return Result();
+        }
+    }
+};
+
 class Programs_Guard
 {
     std::vector<Program*> programs;
@@ -431,6 +596,13 @@ public:
         return prog;
     }
 
+    Program* new_program(std::string source)
+    {
+        auto prog = new Program(std::move(source));
+        programs.push_back(prog);
+        return prog;
+    }
+
     ~Programs_Guard()
     {
         for(auto p : programs)
@@ -0,0 +1,272 @@
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../object.h"
+#include "../evaluator.h"
+#include "../folder.h"
+#include "../gc.h"
+#include "../script.h"
+#include "../stack_evaluator.h"
+#include "../vm.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <fmt/format.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using ast::Program;
+
+static size_t allocations = 0;
+
+void* operator new(size_t size)
+{
+    allocations++;
+    if(auto p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static size_t peak_rss_kib()
+{
+#if defined(__APPLE__)
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss) / 1024;
+#elif defined(__unix__)
+    rusage usage {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return 0;
+#endif
+}
+
+// Runs body once and reports it per operation, body returns how many
+// operations it performed.
+static void run(const string& name, const function<size_t()>& body)
+{
+    auto allocations_before = allocations;
+    auto start = chrono::steady_clock::now();
+    auto ops = body();
+    auto elapsed = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    auto allocated = allocations - allocations_before;
+
+    fmt::print("{:<24}{:>12}{:>14.1f}{:>14.3f}{:>16}\n",
+               name,
+               ops,
+               elapsed / static_cast<double>(ops),
+               static_cast<double>(allocated) / static_cast<double>(ops),
+               peak_rss_kib());
+}
+
+static Program* parse(const string& source, ast::Programs_Guard& guard)
+{
+    auto program = guard.new_program(source);
+    Lexer lexer(program->source);
+    Parser parser(lexer, program->arena);
+    program->statements = parser.parse_program();
+    if(!parser.errors().empty())
+    {
+        fmt::print("parser errors in benchmark source\n");
+        exit(EXIT_FAILURE);
+    }
+    ConstantFolder().fold(program);
+    return program;
+}
+
+static size_t evaluate_source(const string& source, const size_t ops, const Engine engine)
+{
+    ast::Programs_Guard guard;
+    auto program = parse(source, guard);
+
+    if(engine == Engine::VM)
+    {
+        VM vm;
+        vm.run(program);
+    }
+    else
+    {
+        Environment env;
+        gc::RootScope roots(gc::heap(), &env);
+        if(engine == Engine::STACK)
+            StackEvaluator().run(program, &env);
+        else
+            evaluate(program, &env);
+    }
+    gc::heap().collect();
+    return ops;
+}
+
+static const string LEXER_SNIPPET =
+    "variable sumador = procedimiento(x) {\n"
+    "    regresa procedimiento(y) { regresa x + y; };\n"
+    "};\n"
+    "variable resultado = si (10 > 5) { \"diez\" } si_no { \"cinco\" };\n"
+    "variable iguales = (1 + 2) * 3 / 4 - 5 != -6 == !verdadero;\n";
+
+static const string FIB =
+    "variable fib = procedimiento(n) {"
+    "    si (n < 2) { regresa n; }"
+    "    regresa fib(n - 1) + fib(n - 2);"
+    "};"
+    "fib(22);";
+// fib(22) performs 2 * fib(23) - 1 calls
+static constexpr size_t FIB_CALLS = 2 * 28657 - 1;
+
+static const string SUMADOR =
+    "variable sumador = procedimiento(x) { regresa procedimiento(y) { regresa x + y; }; };"
+    "variable bucle = procedimiento(n, acc) {"
+    "    si (n == 0) { regresa acc; }"
+    "    regresa bucle(n - 1, sumador(n)(acc));"
+    "};"
+    "variable repite = procedimiento(k) {"
+    "    si (k == 0) { regresa 0; }"
+    "    bucle(2000, 0);"
+    "    regresa repite(k - 1);"
+    "};"
+    "repite(20);";
+static constexpr size_t SUMADOR_CALLS = 20 * 2000;
+
+static const string CONCAT =
+    "variable concatena = procedimiento(s, n) {"
+    "    si (n == 0) { regresa longitud(s); }"
+    "    regresa concatena(s + \"abcd\", n - 1);"
+    "};"
+    "concatena(\"\", 2000);";
+static constexpr size_t CONCAT_OPS = 2000;
+
+// appends in a loop, the way a report is built line by line
+static const string INFORME =
+    "variable informe = \"\";"
+    "variable i = 0;"
+    "mientras (i < 50000) { informe = informe + \"una linea mas;\"; i = i + 1; };"
+    "longitud(informe) + longitud(informe + \"fin\");";
+static constexpr size_t INFORME_OPS = 50000;
+
+static const string MIENTRAS =
+    "variable i = 0;"
+    "variable suma = 0;"
+    "mientras (i < 100000) {"
+    "    i = i + 1;"
+    "    suma = suma + i * 2;"
+    "};"
+    "suma;";
+static constexpr size_t MIENTRAS_ITERATIONS = 100000;
+
+static const string ARREGLO =
+    "variable a = [];"
+    "variable i = 0;"
+    "mientras (i < 20000) { agregar(a, i); i = i + 1; };"
+    "variable b = concatenar(rebanar(a, 0, 10000), rebanar(a, 10000));"
+    "variable suma = 0;"
+    "i = 0;"
+    "mientras (i < 20000) { suma = suma + b[i]; i = i + 1; };"
+    "suma;";
+// every element is pushed once and read back once
+static constexpr size_t ARREGLO_OPS = 2 * 20000;
+
+static const string DICCIONARIO =
+    "variable d = {};"
+    "variable i = 0;"
+    "mientras (i < 200000) { poner(d, i, i); i = i + 1; };"
+    "variable suma = 0;"
+    "i = 0;"
+    "mientras (i < 200000) { suma = suma + d[i]; i = i + 1; };"
+    "suma;";
+// every key is stored once and looked up once
+static constexpr size_t DICCIONARIO_OPS = 2 * 200000;
+
+static const string CONSTANTES =
+    "variable i = 0;"
+    "variable suma = 0;"
+    "mientras (i < 100000) {"
+    "    si (\"lunes\" + \"martes\" == \"lunesmartes\") { suma = suma + 60 * 60 * 24; };"
+    "    i = i + 1;"
+    "};"
+    "suma;";
+static constexpr size_t CONSTANTES_ITERATIONS = 100000;
+
+int main()
+{
+    fmt::print("{:<24}{:>12}{:>14}{:>14}{:>16}\n", "benchmark", "ops", "ns/op", "allocs/op", "peak RSS KiB");
+
+    run("lexer/next_token", []()
+    {
+        string source;
+        while(source.size() < 4 * 1024 * 1024)
+            source += LEXER_SNIPPET;
+
+        Lexer lexer(source);
+        size_t tokens = 0;
+        for(auto token = lexer.next_token(); token.token_type != TokenType::_EOF; token = lexer.next_token())
+            tokens++;
+        return tokens;
+    });
+
+    run("parser/wide", []()
+    {
+        constexpr size_t statements = 20000;
+        string source;
+        for(size_t i = 0; i < statements; i++)
+            source += fmt::format("variable v{} = {} + 2 * (3 - v{});\n", i, i, i);
+
+        ast::Programs_Guard guard;
+        parse(source, guard);
+        return statements;
+    });
+
+    run("parser/deep", []()
+    {
+        constexpr size_t depth = 1000;
+        constexpr size_t programs = 50;
+        string source;
+        for(size_t i = 0; i < depth; i++)
+            source += "(1 + ";
+        source += "1";
+        for(size_t i = 0; i < depth; i++)
+            source += ")";
+
+        ast::Programs_Guard guard;
+        for(size_t i = 0; i < programs; i++)
+            parse(source, guard);
+        return depth * programs;
+    });
+
+    run("eval/fib", []() { return evaluate_source(FIB, FIB_CALLS, Engine::TREE_WALKER); });
+    run("stack/fib", []() { return evaluate_source(FIB, FIB_CALLS, Engine::STACK); });
+    run("vm/fib", []() { return evaluate_source(FIB, FIB_CALLS, Engine::VM); });
+    run("eval/sumador", []() { return evaluate_source(SUMADOR, SUMADOR_CALLS, Engine::TREE_WALKER); });
+    run("stack/sumador", []() { return evaluate_source(SUMADOR, SUMADOR_CALLS, Engine::STACK); });
+    run("vm/sumador", []() { return evaluate_source(SUMADOR, SUMADOR_CALLS, Engine::VM); });
+    run("eval/concat", []() { return evaluate_source(CONCAT, CONCAT_OPS, Engine::TREE_WALKER); });
+    run("stack/concat", []() { return evaluate_source(CONCAT, CONCAT_OPS, Engine::STACK); });
+    run("vm/concat", []() { return evaluate_source(CONCAT, CONCAT_OPS, Engine::VM); });
+    run("eval/informe", []() { return evaluate_source(INFORME, INFORME_OPS, Engine::TREE_WALKER); });
+    run("stack/informe", []() { return evaluate_source(INFORME, INFORME_OPS, Engine::STACK); });
+    run("vm/informe", []() { return evaluate_source(INFORME, INFORME_OPS, Engine::VM); });
+    run("eval/mientras", []() { return evaluate_source(MIENTRAS, MIENTRAS_ITERATIONS, Engine::TREE_WALKER); });
+    run("stack/mientras", []() { return evaluate_source(MIENTRAS, MIENTRAS_ITERATIONS, Engine::STACK); });
+    run("vm/mientras", []() { return evaluate_source(MIENTRAS, MIENTRAS_ITERATIONS, Engine::VM); });
+    run("eval/constantes", []() { return evaluate_source(CONSTANTES, CONSTANTES_ITERATIONS, Engine::TREE_WALKER); });
+    run("stack/constantes", []() { return evaluate_source(CONSTANTES, CONSTANTES_ITERATIONS, Engine::STACK); });
+    run("vm/constantes", []() { return evaluate_source(CONSTANTES, CONSTANTES_ITERATIONS, Engine::VM); });
+    run("eval/arreglo", []() { return evaluate_source(ARREGLO, ARREGLO_OPS, Engine::TREE_WALKER); });
+    run("stack/arreglo", []() { return evaluate_source(ARREGLO, ARREGLO_OPS, Engine::STACK); });
+    run("vm/arreglo", []() { return evaluate_source(ARREGLO, ARREGLO_OPS, Engine::VM); });
+    run("eval/diccionario", []() { return evaluate_source(DICCIONARIO, DICCIONARIO_OPS, Engine::TREE_WALKER); });
+    run("stack/diccionario", []() { return evaluate_source(DICCIONARIO, DICCIONARIO_OPS, Engine::STACK); });
+    run("vm/diccionario", []() { return evaluate_source(DICCIONARIO, DICCIONARIO_OPS, Engine::VM); });
+
+    return EXIT_SUCCESS;
+}
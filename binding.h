@@ -0,0 +1,111 @@
+#ifndef BINDING_H
+#define BINDING_H
+#include "builtin.h"
+#include "gc.h"
+#include "object.h"
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+// How a host type crosses into the language and back: is tells whether a
+// value can become the type, from converts it, to makes a value of it.
+template<class T>
+struct Convert;
+
+template<class T>
+    requires std::integral<T> && (!std::same_as<T, bool>)
+struct Convert<T>
+{
+    static bool is(Value value) { return value.is_integer(); }
+    static T from(Value value) { return static_cast<T>(value.as_integer()); }
+    static Value to(const T value) { return Value::integer(static_cast<std::int64_t>(value)); }
+};
+
+template<>
+struct Convert<bool>
+{
+    static bool is(Value value) { return value.is_boolean(); }
+    static bool from(Value value) { return value.as_boolean(); }
+    static Value to(const bool value) { return Value::boolean(value); }
+};
+
+// The view points into the string object, which the caller keeps rooted
+// until the bound function returns.
+template<>
+struct Convert<std::string_view>
+{
+    static bool is(Value value) { return value.type() == obj::ObjectType::STRING; }
+    static std::string_view from(Value value) { return value.as<obj::String>()->value(); }
+    static Value to(const std::string_view value) { return gc::heap().make<obj::String>(std::string(value)); }
+};
+
+template<>
+struct Convert<std::string>
+{
+    static bool is(Value value) { return Convert<std::string_view>::is(value); }
+    static std::string from(Value value) { return value.as<obj::String>()->value(); }
+    static Value to(std::string value) { return gc::heap().make<obj::String>(std::move(value)); }
+};
+
+// Any value at all, for functions that check types themselves.
+template<>
+struct Convert<Value>
+{
+    static bool is(Value) { return true; }
+    static Value from(Value value) { return value; }
+    static Value to(Value value) { return value; }
+};
+
+namespace binding
+{
+
+template<auto F, class R, class... Args, std::size_t... I>
+Value call(const std::string_view name, std::span<const Value> args, const int line, std::index_sequence<I...>)
+{
+    constexpr auto arity = sizeof...(Args);
+    if(args.size() != arity)
+        return wrong_args_builtin(name, args.size(), std::to_string(arity), line);
+
+    // the first argument of the wrong type is the one reported
+    auto wrong = arity;
+    ((wrong = wrong == arity && !Convert<std::remove_cvref_t<Args>>::is(args[I]) ? I : wrong), ...);
+    if(wrong != arity)
+        return unsupported_argument(name, args[wrong], line);
+
+    if constexpr(std::is_void_v<R>)
+    {
+        F(Convert<std::remove_cvref_t<Args>>::from(args[I])...);
+        return Value::null();
+    }
+    else
+        return Convert<std::remove_cvref_t<R>>::to(F(Convert<std::remove_cvref_t<Args>>::from(args[I])...));
+}
+
+template<auto F, class R, class... Args>
+BuiltinFunction make(std::string name, R (*)(Args...))
+{
+    return [name = std::move(name)](std::span<const Value> args, const int line) -> Value {
+        return call<F, R, Args...>(name, args, line, std::index_sequence_for<Args...>{});
+    };
+}
+
+} // namespace binding
+
+// Turns a plain function into a builtin called name. The arity and the
+// conversion of every argument and of the result come from the signature of
+// F at compile time; a call with the wrong count or types gets the same
+// errors as the standard builtins.
+//     std::int64_t repetir(std::string_view, std::int64_t);
+//     interpreter.define("repetir", bind<repetir>("repetir"));
+template<auto F>
+BuiltinFunction bind(std::string name)
+{
+    return binding::make<F>(std::move(name), F);
+}
+
+#endif // BINDING_H
@@ -2,11 +2,18 @@
 #define BUILTIN_H
 #include "object.h"
 #include "utils.h"
-#include "cleaner.h"
+#include "gc.h"
+#include "interner.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
-#include <map>
+#include <functional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <vector>
 #include <fmt/format.h>
 
@@ -14,56 +21,270 @@ using obj::Builtin;
 using obj::BuiltinFunction;
 using obj::Object;
 using obj::Error;
+using obj::Value;
 
-static constexpr std::string_view UNSUPPORTED_ARGUMENT_TYPE = "Argumento para longitud sin soporte, se recibió {} cerca de la línea {}";
-static constexpr std::string_view WRONG_ARGS_BUILTIN_FN = "Número incorrecto de argumentos para {}, se recibieron {}, se esperaba 1, cerca de la línea {}";
+static constexpr std::string_view UNSUPPORTED_ARGUMENT_TYPE = "Argumento para {} sin soporte, se recibió {} cerca de la línea {}";
+static constexpr std::string_view WRONG_ARGS_BUILTIN_FN = "Número incorrecto de argumentos para {}, se recibieron {}, se esperaba {}, cerca de la línea {}";
+static constexpr std::string_view UNUSABLE_HASH_KEY = "No se puede usar como clave de un diccionario: {} cerca de la línea {}";
 
-static const BuiltinFunction longitud = [](const std::vector<Object*>& args, const int line) -> Object*
+static Value wrong_args_builtin(const std::string_view name, const std::size_t received, const std::string_view expected, const int line)
+{
+    return gc::heap().make<Error>(fmt::format(WRONG_ARGS_BUILTIN_FN, name, received, expected, line));
+}
+
+static Value unsupported_argument(const std::string_view name, Value argument, const int line)
+{
+    return gc::heap().make<Error>(fmt::format(UNSUPPORTED_ARGUMENT_TYPE, name, argument.type_string(), line));
+}
+
+static Value unusable_hash_key(Value key, const int line)
+{
+    return gc::heap().make<Error>(fmt::format(UNUSABLE_HASH_KEY, key.type_string(), line));
+}
+
+// Checks the arguments every builtin on dictionaries takes first: the
+// dictionary and a key. Returns the error to report, or nullptr.
+static Value check_hash_arguments(const std::string_view name, std::span<const Value> args, const std::size_t expected, const int line)
+{
+    if(args.size() != expected)
+        return wrong_args_builtin(name, args.size(), std::to_string(expected), line);
+    if(args[0].type() != obj::ObjectType::HASH)
+        return unsupported_argument(name, args[0], line);
+    if(!obj::Hash::hashable(args[1]))
+        return unusable_hash_key(args[1], line);
+    return nullptr;
+}
+
+static const BuiltinFunction longitud = [](std::span<const Value> args, const int line) -> Value
 {
     if(args.size() != 1)
+        return wrong_args_builtin("longitud", args.size(), "1", line);
+
+    if(args[0].type() == obj::ObjectType::STRING)
     {
-        auto error = new Error{
-            fmt::format(WRONG_ARGS_BUILTIN_FN,
-                        "longitud",
-                        args.size(),
-                        line
-        )};
-        eval_errors.push_back(error);
-        return error;
+        auto argument = args[0].as<obj::String>();
+        return Value::integer(static_cast<std::int64_t>(argument->size()));
     }
 
-    auto argument = dynamic_cast<obj::String*>(args.at(0));
+    if(args[0].type() == obj::ObjectType::ARRAY)
+    {
+        auto argument = args[0].as<obj::Array>();
+        return Value::integer(static_cast<std::int64_t>(argument->elements.size()));
+    }
+
+    if(args[0].type() == obj::ObjectType::HASH)
+    {
+        auto argument = args[0].as<obj::Hash>();
+        return Value::integer(static_cast<std::int64_t>(argument->size()));
+    }
+
+    return unsupported_argument("longitud", args[0], line);
+};
+
+// Appends to the array it is given, which it also returns, instead of
+// copying it as a pure function would.
+static const BuiltinFunction agregar = [](std::span<const Value> args, const int line) -> Value
+{
+    if(args.size() != 2)
+        return wrong_args_builtin("agregar", args.size(), "2", line);
+
+    if(args[0].type() != obj::ObjectType::ARRAY)
+        return unsupported_argument("agregar", args[0], line);
+
+    auto array = args[0].as<obj::Array>();
+    array->elements.push_back(args[1]);
+    return array;
+};
+
+// rebanar(arreglo, inicio) or rebanar(arreglo, inicio, fin): a new array
+// with the elements from inicio up to, not including, fin. Both bounds are
+// clamped to the array.
+static const BuiltinFunction rebanar = [](std::span<const Value> args, const int line) -> Value
+{
+    if(args.size() != 2 && args.size() != 3)
+        return wrong_args_builtin("rebanar", args.size(), "2 o 3", line);
+
+    if(args[0].type() != obj::ObjectType::ARRAY)
+        return unsupported_argument("rebanar", args[0], line);
+    for(std::size_t i = 1; i < args.size(); i++)
+        if(!args[i].is_integer())
+            return unsupported_argument("rebanar", args[i], line);
+
+    const auto& elements = args[0].as<obj::Array>()->elements;
+    auto size = static_cast<std::int64_t>(elements.size());
+    auto first = std::clamp<std::int64_t>(args[1].as_integer(), 0, size);
+    auto last = args.size() == 3 ? std::clamp<std::int64_t>(args[2].as_integer(), first, size) : size;
 
-    if(argument)
+    // the source array is an argument, so its elements stay rooted while the slice is made
+    return gc::heap().make<obj::Array>(std::vector<Value>(elements.begin() + first, elements.begin() + last));
+};
+
+// A new array with the elements of every array it is given, in order.
+static const BuiltinFunction concatenar = [](std::span<const Value> args, const int line) -> Value
+{
+    std::size_t size = 0;
+    for(auto argument : args)
     {
-        if(argument->value.empty())
-        {
-            auto integer = new obj::Integer(0);
-            cleaner.push_back(integer);
-            return integer;
-        }
-        auto integer = new obj::Integer(argument->value.size());
-        cleaner.push_back(integer);
-        return integer;
+        if(argument.type() != obj::ObjectType::ARRAY)
+            return unsupported_argument("concatenar", argument, line);
+        size += argument.as<obj::Array>()->elements.size();
     }
 
-    auto error = new Error{
-        fmt::format(UNSUPPORTED_ARGUMENT_TYPE,
-                    args.at(0)->type_string(),
-                    line
-    )};
-    eval_errors.push_back(error);
-    return error;
+    std::vector<Value> elements;
+    elements.reserve(size);
+    for(auto argument : args)
+    {
+        const auto& source = argument.as<obj::Array>()->elements;
+        elements.insert(elements.end(), source.begin(), source.end());
+    }
+    return gc::heap().make<obj::Array>(std::move(elements));
 };
 
-static const BuiltinFunction salir = [](const std::vector<Object*>&, const int) -> Object*
+// obtener(diccionario, clave): the value stored for clave, or nulo.
+static const BuiltinFunction obtener = [](std::span<const Value> args, const int line) -> Value
 {
+    if(auto error = check_hash_arguments("obtener", args, 2, line))
+        return error;
+
+    auto value = args[0].as<obj::Hash>()->get(args[1]);
+    return value ? value : Value::null();
+};
+
+// poner(diccionario, clave, valor): stores valor in place and returns the dictionary.
+static const BuiltinFunction poner = [](std::span<const Value> args, const int line) -> Value
+{
+    if(auto error = check_hash_arguments("poner", args, 3, line))
+        return error;
+
+    auto hash = args[0].as<obj::Hash>();
+    hash->set(args[1], args[2]);
+    return hash;
+};
+
+static const BuiltinFunction contiene = [](std::span<const Value> args, const int line) -> Value
+{
+    if(auto error = check_hash_arguments("contiene", args, 2, line))
+        return error;
+
+    return Value::boolean(static_cast<bool>(args[0].as<obj::Hash>()->get(args[1])));
+};
+
+// eliminar(diccionario, clave): verdadero when there was something to remove.
+static const BuiltinFunction eliminar = [](std::span<const Value> args, const int line) -> Value
+{
+    if(auto error = check_hash_arguments("eliminar", args, 2, line))
+        return error;
+
+    return Value::boolean(args[0].as<obj::Hash>()->remove(args[1]));
+};
+
+// estadisticas(): what the heap of the running program made so far. The
+// totals are at the top level and every kind of object made at least once
+// has a dictionary of its own with vivos, asignaciones and bytes.
+static const BuiltinFunction estadisticas = [](std::span<const Value> args, const int line) -> Value
+{
+    if(!args.empty())
+        return wrong_args_builtin("estadisticas", args.size(), "0", line);
+
+    // read before the result itself is allocated
+    auto& heap = gc::heap();
+    std::array<gc::KindStats, gc::Collectable::KINDS> kinds;
+    for(std::size_t i = 0; i < kinds.size(); i++)
+        kinds[i] = heap.stats(i);
+    auto live = heap.live_objects();
+    auto bytes = heap.bytes_allocated();
+    auto peak = heap.peak_bytes();
+    auto collections = heap.collections();
+
+    // every table stays rooted while the strings of its keys are made
+    gc::RootScope roots(heap);
+    auto put = [&heap](obj::Hash* table, const std::string_view key, Value value)
+    {
+        table->set(heap.make<obj::String>(std::string(key)), value);
+    };
+    auto integer = [](const std::size_t n) { return Value::integer(static_cast<std::int64_t>(n)); };
+
+    auto result = heap.make<obj::Hash>();
+    roots.push_back(result);
+    put(result, "vivos", integer(live));
+    put(result, "bytes", integer(bytes));
+    put(result, "pico", integer(peak));
+    put(result, "recolecciones", integer(collections));
+    for(std::size_t i = 0; i < kinds.size(); i++)
+    {
+        if(kinds[i].allocations == 0)
+            continue;
+        auto kind = heap.make<obj::Hash>();
+        roots.push_back(kind);
+        put(kind, "vivos", integer(kinds[i].live));
+        put(kind, "asignaciones", integer(kinds[i].allocations));
+        put(kind, "bytes", integer(kinds[i].bytes));
+        put(result, obj::kind_name(i), kind);
+    }
+    return result;
+};
+
+static const BuiltinFunction salir = [](std::span<const Value> args, const int) -> Value
+{
+    if(args.size() == 1 && args[0].is_integer())
+        exit(static_cast<int>(args[0].as_integer()));
     exit(EXIT_SUCCESS);
 };
 
-static std::map<std::string_view, Builtin> BUILTINS {
-    {"longitud", Builtin(longitud)},
-    {"salir", Builtin(salir)},
+// The builtins one interpreter can call, by name. The collector marks them
+// like any other object it reaches, so each interpreter has a table of its own.
+// Names are Symbols of the interpreter's Interner, the same ones the Resolver
+// gives the identifiers calling them.
+class Builtins
+{
+    Interner& names;
+    std::unordered_map<Symbol, Builtin> table;
+
+public:
+    explicit Builtins(Interner& names) : names(names)
+    {
+        define("longitud", longitud);
+        define("agregar", agregar);
+        define("rebanar", rebanar);
+        define("concatenar", concatenar);
+        define("obtener", obtener);
+        define("poner", poner);
+        define("contiene", contiene);
+        define("eliminar", eliminar);
+        define("estadisticas", estadisticas);
+        define("salir", salir);
+    }
+    Builtins(const Builtins&) = delete;
+    Builtins& operator=(const Builtins&) = delete;
+
+    // Adds fn under name. A builtin already called that keeps its object,
+    // so values referring to it now call fn.
+    void define(const std::string_view name, const BuiltinFunction& fn)
+    {
+        auto [existing, added] = table.try_emplace(names.intern(name), fn);
+        if(!added)
+            existing->second.fn = fn;
+    }
+
+    Builtin* find(const Symbol name)
+    {
+        auto builtin = table.find(name);
+        return builtin == table.end() ? nullptr : &builtin->second;
+    }
 };
 
+// The table of the running thread, swapped by an Interpreter the same way as
+// gc::current_heap.
+inline thread_local Builtins* current_builtins = nullptr;
+
+inline Builtins& builtins()
+{
+    if(!current_builtins) [[unlikely]]
+    {
+        thread_local Builtins thread_builtins(thread_interner());
+        current_builtins = &thread_builtins;
+    }
+    return *current_builtins;
+}
+
 #endif // BUILTIN_H
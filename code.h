@@ -0,0 +1,143 @@
+#ifndef CODE_H
+#define CODE_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "object.h"
+#include "symbol_table.h"
+
+namespace code
+{
+enum class OpCode : std::uint8_t
+{
+    CONSTANT,
+    _TRUE,
+    _FALSE,
+    _NULL,
+    POP,
+    POP_CHECK,
+    // leaves the function with the value on top when it is an error
+    CHECK,
+    // ADD to GT in the order of ast::Operator
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    EQ,
+    NOT_EQ,
+    LT,
+    GT,
+    MINUS,
+    BANG,
+    JUMP,
+    JUMP_IF_FALSE,
+    GET,
+    SET,
+    GET_NAME,
+    CLOSURE,
+    CALL,
+    // a CALL in tail position, reusing the frame of the function it returns from
+    TAIL_CALL,
+    // builds an array from the given number of values on top of the stack
+    ARRAY,
+    // builds a dictionary from the given number of keys and values on top of the stack
+    HASH,
+    INDEX,
+    RETURN
+};
+
+// Width in bytes of each operand, indexed by OpCode.
+static constexpr std::array<std::array<std::uint8_t, 2>, 29> operand_widths {{
+    {4, 0}, // CONSTANT constant index
+    {0, 0}, // _TRUE
+    {0, 0}, // _FALSE
+    {0, 0}, // _NULL
+    {0, 0}, // POP
+    {0, 0}, // POP_CHECK
+    {0, 0}, // CHECK
+    {0, 0}, // ADD
+    {0, 0}, // SUB
+    {0, 0}, // MUL
+    {0, 0}, // DIV
+    {0, 0}, // EQ
+    {0, 0}, // NOT_EQ
+    {0, 0}, // LT
+    {0, 0}, // GT
+    {0, 0}, // MINUS
+    {0, 0}, // BANG
+    {4, 0}, // JUMP target
+    {4, 0}, // JUMP_IF_FALSE target
+    {2, 2}, // GET depth, slot
+    {2, 0}, // SET slot
+    {4, 0}, // GET_NAME name index
+    {4, 0}, // CLOSURE function index
+    {2, 0}, // CALL argument count
+    {2, 0}, // TAIL_CALL argument count
+    {4, 0}, // ARRAY element count
+    {4, 0}, // HASH key and value count
+    {0, 0}, // INDEX
+    {0, 0}  // RETURN
+}};
+
+using Instructions = std::vector<std::uint8_t>;
+
+template<class T>
+inline T read_operand(const std::uint8_t* ip)
+{
+    T value;
+    std::memcpy(&value, ip, sizeof(T));
+    return value;
+}
+
+struct CompiledFunction
+{
+    Instructions instructions;
+    // source line of every byte in instructions, used for error messages
+    std::vector<int> lines;
+    std::vector<obj::Value> constants;
+    std::vector<Symbol> names;
+    std::vector<CompiledFunction*> functions;
+    std::vector<std::size_t> parameter_slots;
+    SymbolTable* symbols = nullptr;
+    // the literal compiled, nullptr for a program's main
+    const ast::Function* definition = nullptr;
+
+    std::size_t emit(const OpCode op, const int line, const std::uint32_t first = 0, const std::uint32_t second = 0)
+    {
+        auto position = instructions.size();
+        auto widths = operand_widths.at(static_cast<std::size_t>(op));
+        instructions.push_back(static_cast<std::uint8_t>(op));
+        write_operand(widths.at(0), first);
+        write_operand(widths.at(1), second);
+        lines.resize(instructions.size(), line);
+        return position;
+    }
+
+    void patch_jump(const std::size_t position, const std::uint32_t target)
+    {
+        std::memcpy(&instructions.at(position + 1), &target, sizeof(target));
+    }
+
+private:
+    void write_operand(const std::uint8_t width, const std::uint32_t value)
+    {
+        if(width == 2)
+        {
+            auto narrow = static_cast<std::uint16_t>(value);
+            auto bytes = reinterpret_cast<const std::uint8_t*>(&narrow);
+            instructions.insert(instructions.end(), bytes, bytes + sizeof(narrow));
+        }
+        else if(width == 4)
+        {
+            auto bytes = reinterpret_cast<const std::uint8_t*>(&value);
+            instructions.insert(instructions.end(), bytes, bytes + sizeof(value));
+        }
+    }
+};
+
+} // namespace code
+#endif // CODE_H
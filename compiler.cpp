@@ -0,0 +1,261 @@
+#include "compiler.h"
+#include "ast.h"
+#include "code.h"
+#include "object.h"
+#include "resolver.h"
+#include "symbol_table.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+using namespace ast;
+using code::OpCode;
+
+code::CompiledFunction* Compiler::compile(Program* program)
+{
+    auto main = functions.emplace_back(make_unique<code::CompiledFunction>()).get();
+    main->symbols = &globals;
+    current = main;
+
+    Resolver(globals).resolve(program);
+
+    for(size_t i = 0; i < program->statements.size(); i++)
+    {
+        auto statement = program->statements.at(i);
+        compile_statement(statement);
+        if(i + 1 < program->statements.size())
+            current->emit(OpCode::POP_CHECK, statement->token.line);
+    }
+    current->emit(OpCode::RETURN, 0);
+
+    return main;
+}
+
+void Compiler::compile_statement(Statement* statement)
+{
+    auto line = statement->token.line;
+
+    switch (statement->type()) {
+        case Node::ExpressionStatement:
+            compile_expression(static_cast<ExpressionStatement*>(statement)->expression);
+            break;
+        case Node::LetStatement:
+            {
+                auto let_statement = static_cast<LetStatement*>(statement);
+                compile_expression(let_statement->value);
+                current->emit(OpCode::SET, line, static_cast<uint32_t>(let_statement->name->slot));
+                break;
+            }
+        case Node::AssignStatement:
+            {
+                auto assign = static_cast<AssignStatement*>(statement);
+                compile_expression(assign->value);
+                current->emit(OpCode::SET, line, static_cast<uint32_t>(assign->name->slot));
+                break;
+            }
+        case Node::ReturnStatement:
+            {
+                auto value = static_cast<ReturnStatement*>(statement)->return_value;
+                // only inside a function, main has no frame to hand over
+                if(value->type() == Node::Call && current->symbols != &globals)
+                    compile_call(static_cast<Call*>(value), OpCode::TAIL_CALL);
+                else
+                    compile_expression(value);
+                current->emit(OpCode::RETURN, line);
+                break;
+            }
+        case Node::Block:
+            compile_block(static_cast<Block*>(statement));
+            break;
+        default:
+            current->emit(OpCode::_NULL, line);
+            break;
+    }
+}
+
+void Compiler::compile_block(Block* block)
+{
+    if(!block || block->statements.empty())
+    {
+        current->emit(OpCode::_NULL, block ? block->token.line : 0);
+        return;
+    }
+
+    for(size_t i = 0; i < block->statements.size(); i++)
+    {
+        auto statement = block->statements.at(i);
+        compile_statement(statement);
+        if(i + 1 < block->statements.size())
+            current->emit(OpCode::POP_CHECK, statement->token.line);
+    }
+}
+
+void Compiler::compile_expression(Expression* expression)
+{
+    if(!expression)
+    {
+        current->emit(OpCode::_NULL, 0);
+        return;
+    }
+
+    auto line = expression->token.line;
+
+    switch (expression->type()) {
+        case Node::Integer:
+            {
+                auto integer = static_cast<ast::Integer*>(expression);
+                auto literal = obj::Value::integer(static_cast<int64_t>(integer->value));
+                current->emit(OpCode::CONSTANT, line, add_constant(literal));
+                break;
+            }
+        case Node::StringLiteral:
+            {
+                auto string_literal = static_cast<StringLiteral*>(expression);
+                auto literal = string_literal->object;
+                if(!literal)
+                    literal = static_cast<obj::String*>(literals.emplace_back(make_unique<obj::String>(string(string_literal->value))).get());
+                current->emit(OpCode::CONSTANT, line, add_constant(literal));
+                break;
+            }
+        case Node::Boolean:
+            current->emit(static_cast<ast::Boolean*>(expression)->value ? OpCode::_TRUE : OpCode::_FALSE, line);
+            break;
+        case Node::Prefix:
+            {
+                auto prefix = static_cast<Prefix*>(expression);
+                compile_expression(prefix->right);
+                current->emit(prefix->op == Operator::MINUS ? OpCode::MINUS : OpCode::BANG, line);
+                break;
+            }
+        case Node::Infix:
+            compile_infix(static_cast<Infix*>(expression));
+            break;
+        case Node::If:
+            {
+                auto if_expression = static_cast<If*>(expression);
+                compile_expression(if_expression->condition);
+                auto jump_if_false = current->emit(OpCode::JUMP_IF_FALSE, line);
+                compile_block(if_expression->consequence);
+                auto jump = current->emit(OpCode::JUMP, line);
+                current->patch_jump(jump_if_false, static_cast<uint32_t>(current->instructions.size()));
+                if(if_expression->alternative)
+                    compile_block(if_expression->alternative);
+                else
+                    current->emit(OpCode::_NULL, line);
+                current->patch_jump(jump, static_cast<uint32_t>(current->instructions.size()));
+                break;
+            }
+        case Node::While:
+            {
+                auto loop = static_cast<While*>(expression);
+                auto start = static_cast<uint32_t>(current->instructions.size());
+                compile_expression(loop->condition);
+                current->emit(OpCode::CHECK, line);
+                auto jump_if_false = current->emit(OpCode::JUMP_IF_FALSE, line);
+                compile_block(loop->body);
+                current->emit(OpCode::POP_CHECK, line);
+                current->emit(OpCode::JUMP, line, start);
+                current->patch_jump(jump_if_false, static_cast<uint32_t>(current->instructions.size()));
+                current->emit(OpCode::_NULL, line);
+                break;
+            }
+        case Node::Identifier:
+            compile_identifier(static_cast<Identifier*>(expression));
+            break;
+        case Node::Function:
+            compile_function(static_cast<ast::Function*>(expression));
+            break;
+        case Node::Call:
+            compile_call(static_cast<Call*>(expression), OpCode::CALL);
+            break;
+        case Node::ArrayLiteral:
+            {
+                auto array = static_cast<ArrayLiteral*>(expression);
+                for(auto element : array->elements)
+                    compile_expression(element);
+                current->emit(OpCode::ARRAY, line, static_cast<uint32_t>(array->elements.size()));
+                break;
+            }
+        case Node::HashLiteral:
+            {
+                auto hash = static_cast<HashLiteral*>(expression);
+                for(auto entry : hash->entries)
+                    compile_expression(entry);
+                current->emit(OpCode::HASH, line, static_cast<uint32_t>(hash->entries.size()));
+                break;
+            }
+        case Node::Index:
+            {
+                auto index = static_cast<Index*>(expression);
+                compile_expression(index->left);
+                compile_expression(index->index);
+                current->emit(OpCode::INDEX, line);
+                break;
+            }
+        default:
+            current->emit(OpCode::_NULL, line);
+            break;
+    }
+}
+
+void Compiler::compile_infix(Infix* infix)
+{
+    compile_expression(infix->left);
+    compile_expression(infix->right);
+
+    // the opcodes from ADD to GT follow the order of ast::Operator
+    auto op = static_cast<int>(OpCode::ADD) + static_cast<int>(infix->op);
+    current->emit(static_cast<OpCode>(op), infix->token.line);
+}
+
+void Compiler::compile_identifier(Identifier* identifier)
+{
+    auto line = identifier->token.line;
+
+    if(identifier->resolved)
+    {
+        current->emit(OpCode::GET, line, static_cast<uint32_t>(identifier->depth), static_cast<uint32_t>(identifier->slot));
+        return;
+    }
+
+    // may still become a global in a later program, or be a builtin
+    current->names.push_back(identifier->symbol);
+    current->emit(OpCode::GET_NAME, line, static_cast<uint32_t>(current->names.size() - 1));
+}
+
+void Compiler::compile_call(Call* call, const OpCode op)
+{
+    compile_expression(call->function);
+    for(auto arg : call->arguments)
+        compile_expression(arg);
+    current->emit(op, call->token.line, static_cast<uint32_t>(call->arguments.size()));
+}
+
+void Compiler::compile_function(ast::Function* fn)
+{
+    auto function = functions.emplace_back(make_unique<code::CompiledFunction>()).get();
+    function->symbols = fn->symbols.get();
+    function->definition = fn;
+
+    for(auto p : fn->parameters)
+        function->parameter_slots.push_back(p->slot);
+
+    auto enclosing = current;
+    current = function;
+
+    compile_block(fn->body);
+    current->emit(OpCode::RETURN, fn->token.line);
+
+    current = enclosing;
+
+    current->functions.push_back(function);
+    current->emit(OpCode::CLOSURE, fn->token.line, static_cast<uint32_t>(current->functions.size() - 1));
+}
+
+uint32_t Compiler::add_constant(obj::Value constant)
+{
+    current->constants.push_back(constant);
+    return static_cast<uint32_t>(current->constants.size() - 1);
+}
@@ -0,0 +1,38 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+#include "ast.h"
+#include "code.h"
+#include "object.h"
+#include "symbol_table.h"
+#include <memory>
+#include <vector>
+
+// Translates an ast::Program into bytecode for the VM. Identifiers the
+// Resolver gave a (depth, slot) pair become GET instructions, so the VM never
+// compares names unless a slot is read before its declaration ran.
+class Compiler
+{
+private:
+    SymbolTable globals;
+    std::vector<std::unique_ptr<code::CompiledFunction>> functions;
+    std::vector<std::unique_ptr<obj::Object>> literals;
+    code::CompiledFunction* current = nullptr;
+
+    void compile_statement(ast::Statement*);
+    void compile_expression(ast::Expression*);
+    void compile_block(ast::Block*);
+    void compile_function(ast::Function*);
+    void compile_call(ast::Call*, const code::OpCode);
+    void compile_infix(ast::Infix*);
+    void compile_identifier(ast::Identifier*);
+    std::uint32_t add_constant(obj::Value);
+
+public:
+    Compiler() = default;
+    Compiler(const Compiler&) = delete;
+    Compiler& operator=(const Compiler&) = delete;
+    code::CompiledFunction* compile(ast::Program*);
+    SymbolTable& global_symbols() { return globals; }
+};
+
+#endif // COMPILER_H
@@ -3,21 +3,26 @@
 #include "ast.h"
 #include "object.h"
 #include "builtin.h"
+#include "profiler.h"
+#include "resolver.h"
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <span>
 #include <string>
 #include <string_view>
-#include <typeinfo>
+#include <utility>
 #include <vector>
 #include "utils.h"
-#include "cleaner.h"
+#include "gc.h"
 #include <fmt/format.h>
 
 using obj::Error;
 using obj::Environment;
 using obj::Object;
 using obj::ObjectType;
+using obj::Value;
 
 using ast::ASTNode;
 using ast::Program;
@@ -31,245 +36,389 @@ using ast::LetStatement;
 using ast::Identifier;
 using ast::Node;
 using ast::AssignStatement;
+using ast::Operator;
 
 static constexpr std::string_view WRONG_ARGS = "Cantidad errónea de argumentos para la función cerca de la línea {}, se esperaban {} pero se obtuvo {}";
 static constexpr std::string_view NOT_A_FUNCTION = "No es una function: {} cerca de la línea {}";
 static constexpr std::string_view TYPE_MISMATCH = "Discrepancia de tipos: {} {} {} cerca de la línea {}";
 static constexpr std::string_view UNKNOWN_PREFIX_OPERATION = "Operador desconocido: {}{} cerca de la línea {}";
 static constexpr std::string_view UNKNOWN_INFIX_OPERATION = "Operador desconocido: {} {} {} cerca de la línea {}";
-
-const static auto TRUE = std::make_unique<obj::Boolean>(true);
-const static auto FALSE = std::make_unique<obj::Boolean>(false);
-const static auto _NULL = std::make_unique<obj::Null>();
-
-static Object* evaluate_program(Program*, Environment*);
-static Object* to_boolean_object(bool);
-static Object* to_boolean_object(const std::string&, Object*, Object*);
-static Object* evaluate_prefix_expression(const std::string&, Object*, const int);
-static Object* evaluate_infix_expression(const std::string&, Object*, Object*, const int);
-static Object* evaluate_if_expression(If*, Environment*);
-static Object* evaluate_block_statements(Block*, Environment*);
-static Object* evaluate_identifier(Identifier*, Environment*);
-static std::vector<Object*> evaluate_expression(const std::vector<Expression*>&, Environment*);
-static Object* apply_function(Object*, const std::vector<Object*>&, const int);
-
-static Object* evaluate(ASTNode* node, Environment* env)
+static constexpr std::string_view INDEX_NOT_SUPPORTED = "Operador de índice no soportado: {}[{}] cerca de la línea {}";
+
+static constexpr std::array<const NameValuePair<Operator>, 9> operators_string {{
+    {Operator::PLUS, "+"},
+    {Operator::MINUS, "-"},
+    {Operator::MULTIPLICATION, "*"},
+    {Operator::DIVISION, "/"},
+    {Operator::EQ, "=="},
+    {Operator::NOT_EQ, "!="},
+    {Operator::LT, "<"},
+    {Operator::GT, ">"},
+    {Operator::NEGATION, "!"}
+}};
+
+inline constexpr Value TRUE = Value::boolean(true);
+inline constexpr Value FALSE = Value::boolean(false);
+inline constexpr Value _NULL = Value::null();
+
+// How the statement just evaluated leaves the statements around it. regresa
+// sets it next to the value it returns, and the function call or program it
+// leaves takes the value and clears it, so returning allocates nothing.
+enum class Unwind { NONE, RETURN, TAIL_CALL };
+
+// What `regresa f(...)` inside a function leaves for apply_function: the
+// call is made once the current one is gone, so tail calls do not nest.
+struct PendingCall
+{
+    Value callee = nullptr;
+    std::vector<Value> arguments;
+    int line = 0;
+};
+
+// Only set between a regresa and the call or program taking its value,
+// during which nothing is evaluated or allocated. The flag is tested after
+// every statement, so it is kept apart from the call, which needs a guarded
+// initialisation on each thread.
+inline thread_local Unwind unwinding = Unwind::NONE;
+inline thread_local PendingCall pending_tail_call;
+
+// Where the tree walker takes the environments of calls that need no heap one.
+inline thread_local obj::EnvironmentPool environment_pool;
+
+static Value evaluate_program(Program*, Environment*);
+static Value to_boolean_object(bool);
+static Value to_boolean_object(Operator, Value, Value);
+static Value evaluate_prefix_expression(Operator, Value, const int);
+static Value evaluate_infix_expression(Operator, Value, Value, const int);
+static Value evaluate_if_expression(If*, Environment*);
+static Value evaluate_while_expression(ast::While*, Environment*);
+static Value evaluate_block_statements(Block*, Environment*);
+static Value evaluate_identifier(Identifier*, Environment*);
+static Value evaluate_index_expression(Value, Value, const int);
+static Value make_array(std::vector<Value>&&);
+static Value make_hash(std::span<const Value>, const int);
+static std::vector<Value> evaluate_expression(const ast::NodeList<Expression>&, Environment*);
+static Value apply_function(Value, const std::vector<Value>&, const int);
+
+static Value evaluate(ASTNode*, Environment*);
+
+class Evaluator : public ast::Visitor<Evaluator, Value, Environment*>
 {
-    auto node_type = node->type();
+public:
+    Value visit(Program* program, Environment* env)
+    {
+        return evaluate_program(program, env);
+    }
 
-    switch (node_type) {
+    Value visit(ExpressionStatement* expression_statement, Environment* env)
+    {
+        return evaluate(expression_statement->expression, env);
+    }
 
-        case Node::Program:
-            return evaluate_program(dynamic_cast<Program*>(node), env);
+    Value visit(ast::Integer* integer, Environment*)
+    {
+        return Value::integer(static_cast<std::int64_t>(integer->value));
+    }
 
-        case Node::ExpressionStatement:
-            {
-                auto cast_exp_st = dynamic_cast<ExpressionStatement*>(node);
-                return evaluate(cast_exp_st->expression, env);
-            }
+    Value visit(ast::Boolean* boolean, Environment*)
+    {
+        return to_boolean_object(boolean->value);
+    }
 
-        case Node::Integer:
-            {
-                auto cast_int = dynamic_cast<ast::Integer*>(node);
-                auto integer = new obj::Integer(cast_int->value);
-                cleaner.push_back(integer);
-                return integer;
-            }
+    Value visit(Prefix* prefix, Environment* env)
+    {
+        auto right = evaluate(prefix->right, env);
+        assert(right != nullptr);
+        return evaluate_prefix_expression(prefix->op, right, prefix->token.line);
+    }
 
-        case Node::Boolean:
-            {
-                auto cast_bool = dynamic_cast<ast::Boolean*>(node);
-                return to_boolean_object(cast_bool->value);
-            }
+    Value visit(Infix* infix, Environment* env)
+    {
+        assert(infix->left && infix->right);
+        auto left = evaluate(infix->left, env);
+        gc::RootScope roots(gc::heap(), left.object());
+        auto right = evaluate(infix->right, env);
+        assert(left && right);
+        return evaluate_infix_expression(infix->op, left, right, infix->token.line);
+    }
 
-        case Node::Prefix:
-            {
-                auto cast_prefix = dynamic_cast<Prefix*>(node);
-                assert(cast_prefix != nullptr);
-                auto right = evaluate(cast_prefix->right, env);
-                assert(right != nullptr);
-                return evaluate_prefix_expression(cast_prefix->operatr, right, cast_prefix->token.line);
-            }
+    Value visit(Block* block, Environment* env)
+    {
+        return evaluate_block_statements(block, env);
+    }
 
-        case Node::Infix:
-            {
-                auto cast_infix = dynamic_cast<Infix*>(node);
-                assert(cast_infix->left && cast_infix->right);
-                auto left = evaluate(cast_infix->left, env);
-                auto right = evaluate(cast_infix->right, env);
-                assert(left && right);
-                return evaluate_infix_expression(cast_infix->operatr, left, right, cast_infix->token.line);
-            }
+    Value visit(If* if_expression, Environment* env)
+    {
+        return evaluate_if_expression(if_expression, env);
+    }
 
-        case Node::Block:
-            {
-                auto cast_block = dynamic_cast<Block*>(node);
-                return evaluate_block_statements(cast_block, env);
-            }
+    Value visit(ast::While* loop, Environment* env)
+    {
+        return evaluate_while_expression(loop, env);
+    }
 
-        case Node::If:
-            {
-                auto cast_if = dynamic_cast<ast::If*>(node);
-                return evaluate_if_expression(cast_if, env);
-            }
+    Value visit(ReturnStatement* return_statement, Environment* env)
+    {
+        assert(return_statement->return_value);
+        // inside a function, the call is left to apply_function once this one returns
+        if(return_statement->return_value->type() == Node::Call && env->outer)
+        {
+            auto call = static_cast<ast::Call*>(return_statement->return_value);
+            auto function = evaluate(call->function, env);
+            gc::RootScope roots(gc::heap(), function.object());
+            auto args = evaluate_expression(call->arguments, env);
+            pending_tail_call = {function, std::move(args), call->token.line};
+            unwinding = Unwind::TAIL_CALL;
+            return _NULL;
+        }
 
-        case Node::ReturnStatement:
-            {
-                auto cast_rtn_st = dynamic_cast<ReturnStatement*>(node);
-                assert(cast_rtn_st->return_value);
-                auto value = evaluate(cast_rtn_st->return_value, env);
-                assert(value);
-                auto return_val = new obj::Return(value);
-                cleaner.push_back(return_val);
-                return return_val;
-            }
+        auto value = evaluate(return_statement->return_value, env);
+        assert(value);
+        unwinding = Unwind::RETURN;
+        return value;
+    }
 
-        case Node::LetStatement:
-            {
-                auto cast_let_st = dynamic_cast<LetStatement*>(node);
-                assert(cast_let_st->value);
-                auto value = evaluate(cast_let_st->value, env);
-                assert(cast_let_st->name);
-                env->set_item(cast_let_st->name->value, value);
-                return value;
-            }
+    Value visit(LetStatement* let_statement, Environment* env)
+    {
+        assert(let_statement->value);
+        auto value = evaluate(let_statement->value, env);
+        assert(let_statement->name);
+        env->slots[let_statement->name->slot] = value;
+        return value;
+    }
 
-        case Node::AssignStatement:
-            {
-                auto cast_assign = dynamic_cast<AssignStatement*>(node);
-                auto value = evaluate(cast_assign->value, env);
-                env->set_item(cast_assign->name->value, value);
-                return value;
-            }
+    Value visit(AssignStatement* assign, Environment* env)
+    {
+        auto value = evaluate(assign->value, env);
+        env->slots[assign->name->slot] = value;
+        return value;
+    }
 
-        case Node::Identifier:
-            {
-                auto cast_ident = dynamic_cast<Identifier*>(node);
-                assert(cast_ident);
-                return evaluate_identifier(cast_ident, env);
-            }
+    Value visit(Identifier* identifier, Environment* env)
+    {
+        return evaluate_identifier(identifier, env);
+    }
 
-        case Node::Function:
-            {
-                auto cast_func = dynamic_cast<ast::Function*>(node);
-                assert(cast_func);
-                auto func = new obj::Function(cast_func->parameters, cast_func->body, env);
-                cleaner.push_back(func);
-                return func;
-            }
+    Value visit(ast::Function* function, Environment* env)
+    {
+        env->captured = true;
+        return gc::heap().make<obj::Function>(function->parameters, function->body, env, function->symbols.get(), function);
+    }
 
-        case Node::Call:
-            {
-                auto cast_call = dynamic_cast<ast::Call*>(node);
-                auto function = evaluate(cast_call->function, env);
-                auto args = evaluate_expression(cast_call->arguments, env);
-                return apply_function(function, args, cast_call->token.line);
-            }
+    Value visit(ast::Call* call, Environment* env)
+    {
+        auto function = evaluate(call->function, env);
+        gc::RootScope roots(gc::heap(), function.object());
+        auto args = evaluate_expression(call->arguments, env);
+        return apply_function(function, args, call->token.line);
+    }
 
-        case Node::StringLiteral:
-            {
-                auto cast_str_lit = dynamic_cast<ast::StringLiteral*>(node);
-                auto str = new obj::String(cast_str_lit->value);
-                cleaner.push_back(str);
-                return str;
-            }
+    Value visit(ast::ArrayLiteral* array, Environment* env)
+    {
+        gc::RootScope roots(gc::heap());
+        return make_array(evaluate_expression(array->elements, env));
+    }
 
-        case Node::Null:
-            return _NULL.get();
+    Value visit(ast::HashLiteral* hash, Environment* env)
+    {
+        gc::RootScope roots(gc::heap());
+        std::vector<Value> entries;
+        entries.reserve(hash->entries.size());
+        for(auto entry : hash->entries)
+        {
+            auto evaluated = evaluate(entry, env);
+            // a key or a value evaluating to nothing counts as nulo
+            if(!evaluated)
+                evaluated = _NULL;
+            roots.push_back(evaluated.object());
+            entries.push_back(evaluated);
+        }
+        return make_hash(entries, hash->token.line);
+    }
 
-        default:
-            return nullptr;
+    Value visit(ast::Index* index, Environment* env)
+    {
+        assert(index->left && index->index);
+        auto left = evaluate(index->left, env);
+        gc::RootScope roots(gc::heap(), left.object());
+        auto position = evaluate(index->index, env);
+        assert(left && position);
+        return evaluate_index_expression(left, position, index->token.line);
+    }
+
+    Value visit(ast::StringLiteral* string_literal, Environment*)
+    {
+        if(string_literal->object)
+            return string_literal->object;
+        return gc::heap().make<obj::String>(std::string(string_literal->value));
+    }
+
+    Value visit(ast::Null*, Environment*)
+    {
+        return _NULL;
     }
+};
+
+Value evaluate(ASTNode* node, Environment* env)
+{
+    return Evaluator().dispatch(node, env);
+}
+
+// Only a closure made during a call can keep its environment once it returns.
+static bool needs_heap_environment(const ast::Function* definition)
+{
+    return !definition || definition->makes_closures;
 }
 
-static Environment* extend_function_environment(obj::Function* fn, const std::vector<Object*>& args, const int line)
+// A tail call runs in the environment of the call it replaces when nothing
+// else can still see it, which otherwise goes back to the pool.
+static Environment* extend_function_environment(obj::Function* fn, const std::vector<Value>& args, Environment* previous = nullptr)
 {
-    if(fn->parameters.size() != args.size())
+    Environment* env = nullptr;
+    if(previous && previous->reusable_for(fn->symbols))
     {
-        auto error = new Error{
-            fmt::format(WRONG_ARGS,
-                        line,
-                        fn->parameters.size(),
-                        args.size()
-        )};
-        eval_errors.push_back(error);
-        return nullptr;
+        env = previous;
+        env->reuse(fn->env);
+    }
+    else
+    {
+        if(previous)
+            environment_pool.release(previous);
+        if(needs_heap_environment(fn->definition))
+            env = gc::heap().make<Environment>(fn->env, fn->symbols);
+        else
+            env = environment_pool.acquire(fn->env, fn->symbols);
     }
-
-    auto env = new Environment(fn->env);
-    environments.push_back(env);
 
     for(std::size_t i = 0; i < fn->parameters.size(); i++)
-        env->set_item(fn->parameters.at(i)->value, args.at(i));
+        env->slots[fn->parameters.at(i)->slot] = args.at(i);
 
     return env;
 }
 
-static Object* unwrap_return_value(Object* obj)
+static bool is_error(Value obj)
+{
+    return obj.is_object() && obj.type() == ObjectType::ERROR;
+}
+
+// Whether the statements around the one just evaluated are left.
+static bool is_unwinding(Value result)
 {
-    if(typeid(*obj) == typeid(obj::Return))
-        return static_cast<obj::Return*>(obj)->value;
-    return obj;
+    return unwinding != Unwind::NONE || is_error(result);
 }
 
-Object* apply_function(Object* fn, const std::vector<Object*>& args, const int line)
+// Gives the environment of the last function a call ran back to the pool
+// however the call ends.
+class EnvironmentScope
+{
+public:
+    Environment* env = nullptr;
+    EnvironmentScope() = default;
+    EnvironmentScope(const EnvironmentScope&) = delete;
+    EnvironmentScope& operator=(const EnvironmentScope&) = delete;
+    ~EnvironmentScope()
+    {
+        if(env)
+            environment_pool.release(env);
+    }
+};
+
+Value apply_function(Value fn, const std::vector<Value>& args, const int line)
 {
-    if(typeid(*fn) == typeid(obj::Function))
+    // holds the environment and the pending tail call of the current iteration
+    gc::RootScope roots(gc::heap());
+    auto profiler = current_profiler;
+    ProfileScope profile(profiler);
+    auto arguments = &args;
+    auto call_line = line;
+    EnvironmentScope frame;
+    std::vector<Value> tail_arguments;
+
+    while(fn.type() == ObjectType::FUNCTION)
     {
-        auto function = static_cast<obj::Function*>(fn);
-        auto extended_environment = extend_function_environment(function, args, line);
-        if(!extended_environment)
-            return eval_errors.at(eval_errors.size() - 1UL);
+        auto function = fn.as<obj::Function>();
+        if(function->parameters.size() != arguments->size())
+        {
+            return gc::heap().make<Error>(
+                fmt::format(WRONG_ARGS,
+                            call_line,
+                            function->parameters.size(),
+                            arguments->size()
+            ));
+        }
+
+        if(profiler) [[unlikely]]
+        {
+            if(frame.env)
+                profiler->tail_call(function->definition);
+            else
+                profiler->enter(function->definition);
+        }
+
+        auto extended_environment = extend_function_environment(function, *arguments, frame.env);
+        frame.env = extended_environment;
+        roots.reset();
+        roots.push_back(extended_environment);
 
+        // a regresa evaluated among the arguments does not leave the callee
+        unwinding = Unwind::NONE;
         auto evaluated = evaluate(function->body, extended_environment);
-        return unwrap_return_value(evaluated);
+        if(std::exchange(unwinding, Unwind::NONE) != Unwind::TAIL_CALL)
+            return evaluated;
+
+        auto& tail_call = pending_tail_call;
+        fn = tail_call.callee;
+        tail_arguments = std::move(tail_call.arguments);
+        call_line = tail_call.line;
+        roots.push_back(fn.object());
+        for(auto argument : tail_arguments)
+            roots.push_back(argument.object());
+        arguments = &tail_arguments;
     }
-    else if(typeid(*fn) == typeid(obj::Builtin))
+
+    if(fn.type() == ObjectType::BUILTIN)
     {
-        auto function = static_cast<obj::Builtin*>(fn);
-        return function->fn(args, line);
+        auto function = fn.as<obj::Builtin>();
+        return function->fn(*arguments, call_line);
     }
 
-    auto error = new Error{
+    return gc::heap().make<Error>(
         fmt::format(NOT_A_FUNCTION,
-                    fn->type_string(),
-                    line
-    )};
-    eval_errors.push_back(error);
-    return error;
+                    fn.type_string(),
+                    call_line
+    ));
 }
 
-Object* evaluate_program(Program* program, Environment* env)
+Value evaluate_program(Program* program, Environment* env)
 {
-    Object* result = nullptr;
+    gc::RootScope roots(gc::heap(), env);
+    Resolver(*env->symbols).resolve(program);
+    env->grow();
+
+    Value result = nullptr;
     for(auto s : program->statements)
     {
         result = evaluate(s, env);
-        if(typeid(*result) == typeid(obj::Return))
-        {
-            auto cast_result = static_cast<obj::Return*>(result);
-            return cast_result->value;
-        }
-        else if (typeid(*result) == typeid(obj::Error))
+        if(std::exchange(unwinding, Unwind::NONE) != Unwind::NONE || is_error(result))
             return result;
     }
 
     return result;
 }
 
-static bool is_truthy(Object* obj)
+static bool is_truthy(Value obj)
 {
-    if(obj == _NULL.get())
+    if(obj == _NULL)
         return false;
-    else if(obj == TRUE.get())
+    else if(obj == TRUE)
         return true;
-    else if(obj == FALSE.get())
+    else if(obj == FALSE)
         return false;
     else
         return true;
 }
 
-Object* evaluate_if_expression(If* if_expression, Environment* env)
+Value evaluate_if_expression(If* if_expression, Environment* env)
 {
     assert(if_expression->condition);
     auto condicion = evaluate(if_expression->condition, env);
@@ -283,266 +432,351 @@ Object* evaluate_if_expression(If* if_expression, Environment* env)
     else if (if_expression->alternative)
         return evaluate(if_expression->alternative, env);
     else
-        return _NULL.get();
+        return _NULL;
+}
+
+// The body runs in the enclosing scope, so an iteration that only does
+// integer arithmetic on existing variables allocates nothing.
+Value evaluate_while_expression(ast::While* loop, Environment* env)
+{
+    assert(loop->condition && loop->body);
+    auto profiler = current_profiler;
+    for(;;)
+    {
+        if(profiler) [[unlikely]]
+            profiler->poll();
+
+        auto condition = evaluate(loop->condition, env);
+        assert(condition);
+        if(is_error(condition))
+            return condition;
+        if(!is_truthy(condition))
+            return _NULL;
+
+        auto result = evaluate(loop->body, env);
+        if(is_unwinding(result))
+            return result;
+    }
 }
 
-Object* evaluate_block_statements(Block* block, Environment* env)
+Value evaluate_block_statements(Block* block, Environment* env)
 {
-    Object* result = nullptr;
+    Value result = nullptr;
 
     for (auto statement : block->statements)
     {
         result = evaluate(statement, env);
-
-        if((result && result->type() == ObjectType::RETURN)
-            || result->type() == ObjectType::ERROR)
+        if(is_unwinding(result))
             return result;
     }
 
     return result;
 }
 
-static Object* evaluate_bang_operator_expression(Object* right)
+static Value evaluate_bang_operator_expression(Value right)
 {
-    if(right == TRUE.get())
-        return FALSE.get();
-    else if(right == FALSE.get())
-        return TRUE.get();
-    else if(right == _NULL.get())
-        return TRUE.get();
+    if(right == TRUE)
+        return FALSE;
+    else if(right == FALSE)
+        return TRUE;
+    else if(right == _NULL)
+        return TRUE;
     else
-        return FALSE.get();
+        return FALSE;
 }
 
-static Object* evaluate_minus_operator_expression(Object* right, const int line)
+static Value evaluate_minus_operator_expression(Value right, const int line)
 {
-    if(typeid(*right).name() != typeid(obj::Integer).name())
+    if(!right.is_integer())
     {
-        auto error = new Error{
+        return gc::heap().make<Error>(
             fmt::format(UNKNOWN_PREFIX_OPERATION,
                         "-",
-                        right->type_string(),
+                        right.type_string(),
                         line
-        )};
-        eval_errors.push_back(error);
-        return error;
+        ));
     }
 
-    auto cast_right = dynamic_cast<obj::Integer*>(right);
-    auto integer = new obj::Integer(-cast_right->value);
-    cleaner.push_back(integer);
-    return integer;
+    return Value::integer(-right.as_integer());
 }
 
-Object* evaluate_prefix_expression(const std::string& operatr, Object* right, const int line)
+Value evaluate_prefix_expression(Operator op, Value right, const int line)
 {
-    if(operatr == "!")
-        return evaluate_bang_operator_expression(right);
-    else if(operatr == "-")
-        return evaluate_minus_operator_expression(right, line);
-    else
-    {
-        auto error = new Error{
-            fmt::format(UNKNOWN_PREFIX_OPERATION,
-                        operatr,
-                        right->type_string(),
-                        line
-        )};
-        eval_errors.push_back(error);
-        return error;
+    switch (op) {
+        case Operator::NEGATION:
+            return evaluate_bang_operator_expression(right);
+        case Operator::MINUS:
+            return evaluate_minus_operator_expression(right, line);
+        default:
+            return gc::heap().make<Error>(
+                fmt::format(UNKNOWN_PREFIX_OPERATION,
+                            getNameForValue(operators_string, op),
+                            right.type_string(),
+                            line
+            ));
     }
-
 }
 
-static Object* evaluate_integer_infix_expression(const std::string& operatr, Object* left, Object* right, const int line)
+static Value evaluate_unknown_infix_expression(Operator op, Value left, Value right, const int line)
 {
-    auto left_value = static_cast<obj::Integer*>(left)->value;
-    auto right_value = static_cast<obj::Integer*>(right)->value;
+    return gc::heap().make<Error>(
+        fmt::format(UNKNOWN_INFIX_OPERATION,
+                    left.type_string(),
+                    getNameForValue(operators_string, op),
+                    right.type_string(),
+                    line
+    ));
+}
 
-    if (operatr == "+")
-    {
-        auto integer = new obj::Integer(left_value + right_value);
-        cleaner.push_back(integer);
-        return integer;
-    }
-    else if (operatr == "-")
-    {
-        auto integer = new obj::Integer(left_value - right_value);
-        cleaner.push_back(integer);
-        return integer;
-    }
-    else if (operatr == "*")
-    {
-        auto integer = new obj::Integer(left_value * right_value);
-        cleaner.push_back(integer);
-        return integer;
+static Value evaluate_integer_infix_expression(Operator op, Value left, Value right, const int line)
+{
+    auto left_value = left.as_integer();
+    auto right_value = right.as_integer();
+
+    switch (op) {
+        case Operator::PLUS:
+            return Value::integer(left_value + right_value);
+        case Operator::MINUS:
+            return Value::integer(left_value - right_value);
+        case Operator::MULTIPLICATION:
+            return Value::integer(left_value * right_value);
+        case Operator::DIVISION:
+            return Value::integer(left_value / right_value);
+        case Operator::LT:
+            return to_boolean_object(left_value < right_value);
+        case Operator::GT:
+            return to_boolean_object(left_value > right_value);
+        case Operator::EQ:
+            return to_boolean_object(left_value == right_value);
+        case Operator::NOT_EQ:
+            return to_boolean_object(left_value != right_value);
+        default:
+            return evaluate_unknown_infix_expression(op, left, right, line);
     }
-    else if (operatr == "/")
-    {
-        auto integer = new obj::Integer(left_value / right_value);
-        cleaner.push_back(integer);
-        return integer;
+}
+
+static Value evaluate_string_infix_expression(Operator op, Value left, Value right, const int line)
+{
+    // the same literal, or two with the same text, are one object
+    if(left == right && (op == Operator::EQ || op == Operator::NOT_EQ))
+        return to_boolean_object(op == Operator::EQ);
+
+    auto left_string = left.as<obj::String>();
+    auto right_string = right.as<obj::String>();
+
+    switch (op) {
+        case Operator::PLUS:
+            if(left_string->size() + right_string->size() < obj::String::MIN_ROPE_LENGTH)
+                return gc::heap().make<obj::String>(left_string->value() + right_string->value());
+            else
+            {
+                // the engines only keep left rooted, and the node refers to both
+                gc::RootScope roots(gc::heap(), right_string);
+                return gc::heap().make<obj::String>(left_string, right_string);
+            }
+        case Operator::EQ:
+            return to_boolean_object(left_string->size() == right_string->size() && left_string->value() == right_string->value());
+        case Operator::NOT_EQ:
+            return to_boolean_object(left_string->size() != right_string->size() || left_string->value() != right_string->value());
+        default:
+            return evaluate_unknown_infix_expression(op, left, right, line);
     }
-    else if (operatr == "<")
-        return to_boolean_object(left_value < right_value);
-    else if (operatr == ">")
-        return to_boolean_object(left_value > right_value);
-    else if (operatr == "==")
-        return to_boolean_object(left_value == right_value);
-    else if (operatr == "!=")
-        return to_boolean_object(left_value != right_value);
-    else
+}
+
+static Value evaluate_mixed_infix_expression(Operator op, Value left, Value right, const int line)
+{
+    if(op == Operator::EQ || op == Operator::NOT_EQ)
+        return to_boolean_object(op, left, right);
+    else if(left.type() != right.type())
     {
-        auto error = new Error{
-            fmt::format(UNKNOWN_INFIX_OPERATION,
-                        left->type_string(),
-                        operatr,
-                        right->type_string(),
+        return gc::heap().make<Error>(
+            fmt::format(TYPE_MISMATCH,
+                        left.type_string(),
+                        getNameForValue(operators_string, op),
+                        right.type_string(),
                         line
-        )};
-        eval_errors.push_back(error);
-        return error;
+        ));
     }
 
+    return evaluate_unknown_infix_expression(op, left, right, line);
+}
+
+using InfixFunction = Value (*)(Operator, Value, Value, const int);
+static constexpr std::size_t OBJECT_TYPES = obj::objects_enums_string.size();
+using InfixTable = std::array<std::array<InfixFunction, OBJECT_TYPES>, OBJECT_TYPES>;
+
+// Indexed by the (left, right) pair of ObjectTypes.
+static constexpr InfixTable make_infix_table()
+{
+    InfixTable table {};
+    for(auto& row : table)
+        for(auto& entry : row)
+            entry = evaluate_mixed_infix_expression;
+
+    constexpr auto integer = static_cast<std::size_t>(ObjectType::INTEGER);
+    constexpr auto string = static_cast<std::size_t>(ObjectType::STRING);
+    table[integer][integer] = evaluate_integer_infix_expression;
+    table[string][string] = evaluate_string_infix_expression;
+    return table;
 }
 
-static Object* evaluate_string_infix_expression(const std::string& operatr, Object* left, Object* right, const int line)
+static constexpr InfixTable INFIX_TABLE = make_infix_table();
+
+Value evaluate_infix_expression(Operator op, Value left, Value right, const int line)
 {
-    auto left_value = static_cast<obj::String*>(left)->value;
-    auto right_value = static_cast<obj::String*>(right)->value;
+    auto left_type = static_cast<std::size_t>(left.type());
+    auto right_type = static_cast<std::size_t>(right.type());
+    return INFIX_TABLE[left_type][right_type](op, left, right, line);
+}
 
-    if(operatr == "+")
+Value evaluate_identifier(Identifier* ident, Environment* env)
+{
+    Value value = nullptr;
+    if(ident->resolved)
     {
-        auto str = new obj::String(left_value + right_value);
-        cleaner.push_back(str);
-        return str;
+        for(std::size_t i = 0; i < ident->depth; i++)
+            env = env->outer;
+        value = env->slots[ident->slot];
+        // read before its declaration ran, keep looking in the outer scopes
+        if(!value && env->outer)
+            value = env->outer->find(ident->symbol);
     }
-    else if(operatr == "==")
-        return to_boolean_object(left_value == right_value);
-    else if(operatr == "!=")
-        return to_boolean_object(left_value != right_value);
+    else
+        value = env->find(ident->symbol);
 
-    auto error = new Error{
-        fmt::format(UNKNOWN_INFIX_OPERATION,
-                    left->type_string(),
-                    operatr,
-                    right->type_string(),
-                    line
-    )};
-    eval_errors.push_back(error);
-    return error;
+    if(value)
+        return value;
+    else if(auto builtin = builtins().find(ident->symbol))
+        return builtin;
+    else
+        return _NULL;
 }
 
-Object* evaluate_infix_expression(const std::string& operatr, Object* left, Object* right, const int line)
+// Out of range positions give nulo rather than an error.
+Value evaluate_index_expression(Value left, Value index, const int line)
 {
-    if(left->type() == ObjectType::INTEGER && right->type() == ObjectType::INTEGER)
-        return evaluate_integer_infix_expression(operatr, left, right, line);
-    else if(left->type() == ObjectType::STRING && right->type() == ObjectType::STRING)
-        return evaluate_string_infix_expression(operatr, left, right, line);
-    else if(operatr == "==" || operatr == "!=")
-        return to_boolean_object(operatr, left, right);
-    else if(left->type() != right->type())
-    {
-        auto error = new Error{
-            fmt::format(TYPE_MISMATCH,
-                        left->type_string(),
-                        operatr,
-                        right->type_string(),
-                        line
-        )};
-        eval_errors.push_back(error);
-        return error;
+    if(left.type() == ObjectType::ARRAY && index.is_integer())
+    {
+        const auto& elements = left.as<obj::Array>()->elements;
+        auto position = index.as_integer();
+        if(position < 0 || static_cast<std::size_t>(position) >= elements.size())
+            return _NULL;
+        return elements[static_cast<std::size_t>(position)];
     }
 
+    if(left.type() == ObjectType::HASH)
+    {
+        if(!obj::Hash::hashable(index))
+            return unusable_hash_key(index, line);
+        auto value = left.as<obj::Hash>()->get(index);
+        return value ? value : _NULL;
+    }
 
-    auto error = new Error{
-        fmt::format(UNKNOWN_INFIX_OPERATION,
-                    left->type_string(),
-                    operatr,
-                    right->type_string(),
+    return gc::heap().make<Error>(
+        fmt::format(INDEX_NOT_SUPPORTED,
+                    left.type_string(),
+                    index.type_string(),
                     line
-    )};
-    eval_errors.push_back(error);
-    return error;
+    ));
 }
 
-Object* evaluate_identifier(Identifier* ident, Environment* env)
+// An array literal evaluates to the first error among its elements, if any.
+// The caller keeps the elements rooted until the array holds them.
+Value make_array(std::vector<Value>&& elements)
 {
-    if(env->item_exist(ident->value))
-        return env->get_item(ident->value);
-    else if(BUILTINS.find(ident->value) != BUILTINS.end())
-        return &BUILTINS.at(ident->value);
-    else
-        return _NULL.get();
+    for(auto element : elements)
+        if(element.type() == ObjectType::ERROR)
+            return element;
+    return gc::heap().make<obj::Array>(std::move(elements));
 }
 
-std::vector<Object*> evaluate_expression(const std::vector<Expression*>& expressions, Environment* env)
+// Builds a dictionary from alternating keys and values, or gives the first
+// error among them. The caller keeps them rooted until the table holds them.
+Value make_hash(std::span<const Value> entries, const int line)
 {
-    auto result = std::vector<Object*>();
+    for(auto entry : entries)
+        if(entry.type() == ObjectType::ERROR)
+            return entry;
+    for(std::size_t i = 0; i < entries.size(); i += 2)
+        if(!obj::Hash::hashable(entries[i]))
+            return unusable_hash_key(entries[i], line);
+
+    auto hash = gc::heap().make<obj::Hash>();
+    hash->reserve(entries.size() / 2);
+    for(std::size_t i = 0; i < entries.size(); i += 2)
+        hash->set(entries[i], entries[i + 1]);
+    return hash;
+}
+
+std::vector<Value> evaluate_expression(const ast::NodeList<Expression>& expressions, Environment* env)
+{
+    auto result = std::vector<Value>();
     for(auto exp : expressions)
     {
         auto evaluated = evaluate(exp, env);
         if(evaluated)
+        {
+            // the caller's RootScope drops these once the call is applied
+            gc::heap().push_root(evaluated.object());
             result.push_back(evaluated);
+        }
     }
     return result;
 }
 
-Object* to_boolean_object(bool value)
+Value to_boolean_object(bool value)
 {
-    return value ? TRUE.get() : FALSE.get();
+    return value ? TRUE : FALSE;
 }
 
-Object* to_boolean_object(const std::string& operatr, Object* left, Object* right)
+Value to_boolean_object(Operator op, Value left, Value right)
 {
-    switch (left->type()) {
+    switch (left.type()) {
         case ObjectType::BOOLEAN:
             {
-                if(right->type() == ObjectType::BOOLEAN && operatr == "==") {
-                    auto value = static_cast<obj::Boolean*>(left)->value
-                        == static_cast<obj::Boolean*>(right)->value;
-                    return value ? TRUE.get() : FALSE.get();
+                if(right.type() == ObjectType::BOOLEAN && op == Operator::EQ) {
+                    auto value = left.as_boolean() == right.as_boolean();
+                    return value ? TRUE : FALSE;
                 }
-                if(right->type() == ObjectType::BOOLEAN && operatr == "!=") {
-                    auto value = static_cast<obj::Boolean*>(left)->value
-                        != static_cast<obj::Boolean*>(right)->value;
-                    return value ? TRUE.get() : FALSE.get();
+                if(right.type() == ObjectType::BOOLEAN && op == Operator::NOT_EQ) {
+                    auto value = left.as_boolean() != right.as_boolean();
+                    return value ? TRUE : FALSE;
                 }
-                if(operatr == "!=")
-                    return TRUE.get();
+                if(op == Operator::NOT_EQ)
+                    return TRUE;
 
-                return FALSE.get();
+                return FALSE;
             }
 
         case ObjectType::INTEGER:
             {
-                if(operatr == "!=")
-                    return TRUE.get();
+                if(op == Operator::NOT_EQ)
+                    return TRUE;
 
-                return FALSE.get();
+                return FALSE;
             }
 
         case ObjectType::STRING:
             {
-                if(operatr == "!=")
-                    return TRUE.get();
+                if(op == Operator::NOT_EQ)
+                    return TRUE;
 
-                return FALSE.get();
+                return FALSE;
 
             }
 
         case ObjectType::_NULL:
             {
-                if(right->type() == ObjectType::_NULL && operatr == "==")
-                    return TRUE.get();
-                if(operatr == "!=" && right->type() != ObjectType::_NULL)
-                    return TRUE.get();
+                if(right.type() == ObjectType::_NULL && op == Operator::EQ)
+                    return TRUE;
+                if(op == Operator::NOT_EQ && right.type() != ObjectType::_NULL)
+                    return TRUE;
 
-                return FALSE.get();
+                return FALSE;
             }
 
         default:
-            return FALSE.get();
+            return FALSE;
     }
 }
 
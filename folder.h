@@ -0,0 +1,235 @@
+#ifndef FOLDER_H
+#define FOLDER_H
+#include "ast.h"
+#include "evaluator.h"
+#include "object.h"
+#include "token.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+// Runs once over a parsed program, before any engine sees it. Every string
+// literal gets the String all its evaluations return, one per distinct text
+// so equal literals compare by address, and a prefix or infix
+// expression whose operands are literals is replaced by the literal of its
+// result, so `60 * 60 * 24` costs what `86400` does. Expressions that would
+// end in an error, or divide by zero, are left to do so when they run.
+class ConstantFolder : public ast::Visitor<ConstantFolder, ast::Expression*>
+{
+private:
+    friend class ast::Visitor<ConstantFolder, ast::Expression*>;
+    ast::Program* program = nullptr;
+    // the constants of program by their text
+    std::unordered_map<std::string_view, obj::String*> strings;
+
+    // the expression that replaces expression, itself when nothing folds
+    ast::Expression* fold(ast::Expression* expression) { return expression ? dispatch(expression) : nullptr; }
+
+    void fold_statement(ast::ASTNode* statement)
+    {
+        if(statement)
+            dispatch(statement);
+    }
+
+    ast::Expression* visit(ast::LetStatement* let_statement)
+    {
+        let_statement->value = fold(let_statement->value);
+        return nullptr;
+    }
+
+    ast::Expression* visit(ast::AssignStatement* assign)
+    {
+        assign->value = fold(assign->value);
+        return nullptr;
+    }
+
+    ast::Expression* visit(ast::ExpressionStatement* expression_statement)
+    {
+        expression_statement->expression = fold(expression_statement->expression);
+        return nullptr;
+    }
+
+    ast::Expression* visit(ast::ReturnStatement* return_statement)
+    {
+        return_statement->return_value = fold(return_statement->return_value);
+        return nullptr;
+    }
+
+    ast::Expression* visit(ast::Block* block)
+    {
+        for(auto s : block->statements)
+            fold_statement(s);
+        return nullptr;
+    }
+
+    ast::Expression* visit(ast::If* if_expression)
+    {
+        if_expression->condition = fold(if_expression->condition);
+        fold_statement(if_expression->consequence);
+        fold_statement(if_expression->alternative);
+        return if_expression;
+    }
+
+    ast::Expression* visit(ast::While* loop)
+    {
+        loop->condition = fold(loop->condition);
+        fold_statement(loop->body);
+        return loop;
+    }
+
+    ast::Expression* visit(ast::Function* fn)
+    {
+        fold_statement(fn->body);
+        return fn;
+    }
+
+    ast::Expression* visit(ast::Call* call)
+    {
+        call->function = fold(call->function);
+        for(auto& arg : call->arguments)
+            arg = fold(arg);
+        return call;
+    }
+
+    ast::Expression* visit(ast::ArrayLiteral* array)
+    {
+        for(auto& element : array->elements)
+            element = fold(element);
+        return array;
+    }
+
+    ast::Expression* visit(ast::HashLiteral* hash)
+    {
+        for(auto& entry : hash->entries)
+            entry = fold(entry);
+        return hash;
+    }
+
+    ast::Expression* visit(ast::Index* index)
+    {
+        index->left = fold(index->left);
+        index->index = fold(index->index);
+        return index;
+    }
+
+    ast::Expression* visit(ast::StringLiteral* string_literal)
+    {
+        string_literal->object = make_string(std::string(string_literal->value));
+        return string_literal;
+    }
+
+    ast::Expression* visit(ast::Prefix* prefix);
+    ast::Expression* visit(ast::Infix* infix);
+
+    // identifiers, the other literals and nested programs stay as they are
+    template<typename Node>
+    ast::Expression* visit(Node* node)
+    {
+        if constexpr(std::is_base_of_v<ast::Expression, Node>)
+            return node;
+        else
+            return nullptr;
+    }
+
+    obj::String* make_string(std::string value)
+    {
+        if(auto existing = strings.find(value); existing != strings.end())
+            return existing->second;
+
+        auto string = std::make_unique<obj::String>(std::move(value));
+        auto object = string.get();
+        strings.emplace(object->value(), object);
+        program->constants.push_back(std::move(string));
+        return object;
+    }
+
+    static obj::Value constant(const ast::Expression* expression);
+    ast::Expression* literal(obj::Value value, const Token& token);
+
+public:
+    void fold(ast::Program*);
+};
+
+inline void ConstantFolder::fold(ast::Program* program)
+{
+    this->program = program;
+    strings.clear();
+    for(auto s : program->statements)
+        fold_statement(s);
+}
+
+// The value of a literal, nullptr for any other expression.
+inline obj::Value ConstantFolder::constant(const ast::Expression* expression)
+{
+    switch (expression->type()) {
+        case ast::Node::Integer:
+            return obj::Value::integer(static_cast<std::int64_t>(static_cast<const ast::Integer*>(expression)->value));
+        case ast::Node::Boolean:
+            return obj::Value::boolean(static_cast<const ast::Boolean*>(expression)->value);
+        case ast::Node::StringLiteral:
+            return static_cast<const ast::StringLiteral*>(expression)->object;
+        default:
+            return nullptr;
+    }
+}
+
+// The literal node standing for value, where token was.
+inline ast::Expression* ConstantFolder::literal(obj::Value value, const Token& token)
+{
+    if(value.is_integer())
+        return program->arena.make<ast::Integer>(token, static_cast<std::size_t>(value.as_integer()));
+    if(value.is_boolean())
+    {
+        auto name = value.as_boolean() ? "verdadero" : "falso";
+        auto type = value.as_boolean() ? TokenType::_TRUE : TokenType::_FALSE;
+        return program->arena.make<ast::Boolean>(Token(type, name, token.line, std::char_traits<char>::length(name)), value.as_boolean());
+    }
+
+    auto text = std::string_view(value.as<obj::String>()->value());
+    auto string_literal = program->arena.make<ast::StringLiteral>(Token(TokenType::STRING, text.data(), token.line, text.size()), text);
+    string_literal->object = value.as<obj::String>();
+    return string_literal;
+}
+
+inline ast::Expression* ConstantFolder::visit(ast::Prefix* prefix)
+{
+    prefix->right = fold(prefix->right);
+    auto right = prefix->right ? constant(prefix->right) : nullptr;
+    if(!right || (prefix->op == ast::Operator::MINUS && !right.is_integer()))
+        return prefix;
+
+    // ! takes any value and - an integer, neither of them allocates
+    return literal(evaluate_prefix_expression(prefix->op, right, prefix->token.line), prefix->token);
+}
+
+inline ast::Expression* ConstantFolder::visit(ast::Infix* infix)
+{
+    infix->left = fold(infix->left);
+    infix->right = fold(infix->right);
+    auto left = infix->left ? constant(infix->left) : nullptr;
+    auto right = infix->right ? constant(infix->right) : nullptr;
+    if(!left || !right)
+        return infix;
+
+    auto op = infix->op;
+    auto line = infix->token.line;
+    auto comparison = op == ast::Operator::EQ || op == ast::Operator::NOT_EQ;
+
+    if(left.is_integer() && right.is_integer())
+    {
+        if(op == ast::Operator::DIVISION && right.as_integer() == 0)
+            return infix;
+        return literal(evaluate_infix_expression(op, left, right, line), infix->token);
+    }
+    if(left.is_object() && right.is_object() && op == ast::Operator::PLUS)
+        return literal(make_string(left.as<obj::String>()->value() + right.as<obj::String>()->value()), infix->token);
+    // comparisons of strings and booleans give a boolean without allocating
+    if(comparison && left.type() == right.type())
+        return literal(evaluate_infix_expression(op, left, right, line), infix->token);
+    return infix;
+}
+
+#endif // FOLDER_H
@@ -0,0 +1,219 @@
+#ifndef GC_H
+#define GC_H
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace gc
+{
+class Heap;
+
+// Base of every object the heap can reclaim. The mark is an epoch number
+// instead of a flag so objects living outside the heap (the builtins and the
+// global environment of an interpreter) can be traced without ever having to
+// be unmarked again.
+class Collectable
+{
+    friend class Heap;
+    Collectable* next_object = nullptr;
+    std::size_t mark_epoch = 0;
+    std::size_t allocated_size = 0;
+
+public:
+    // Which counters of Heap::stats the object goes into; the kinds
+    // themselves are defined by the objects.
+    static constexpr std::size_t KINDS = 16;
+    virtual std::size_t kind() const { return KINDS - 1; }
+
+    virtual void trace(Heap&) {}
+    virtual ~Collectable(){}
+    Collectable() = default;
+    Collectable (const Collectable&) = delete;
+    Collectable& operator=(const Collectable&) = delete;
+    Collectable (Collectable&&) = delete;
+    Collectable& operator=(Collectable&&) = delete;
+};
+
+// What the heap made of one kind of object. bytes only counts the objects
+// themselves, as the collection threshold does, not the buffers they own.
+struct KindStats
+{
+    std::size_t live = 0;
+    std::size_t allocations = 0;
+    std::size_t bytes = 0;
+};
+
+class Heap
+{
+public:
+    static constexpr std::size_t DEFAULT_THRESHOLD = 1024 * 1024;
+
+private:
+    static constexpr std::size_t GROWTH_FACTOR = 2;
+
+    Collectable* objects = nullptr;
+    std::vector<Collectable*> roots;
+    std::vector<Collectable*> gray;
+    // Drawn from one counter for every heap, so an object outside all of
+    // them, such as a pooled environment, can be traced by one heap after
+    // another without looking already marked to the next.
+    static inline std::atomic<std::size_t> epochs = 1;
+    std::size_t epoch = 1;
+    std::size_t threshold = DEFAULT_THRESHOLD;
+    std::size_t next_collection = DEFAULT_THRESHOLD;
+    std::size_t bytes = 0;
+    std::size_t objects_count = 0;
+    std::size_t collections_count = 0;
+    std::size_t peak = 0;
+    std::array<KindStats, Collectable::KINDS> kinds {};
+
+    void sweep()
+    {
+        auto link = &objects;
+        while(*link)
+        {
+            auto obj = *link;
+            if(obj->mark_epoch == epoch)
+            {
+                link = &obj->next_object;
+                continue;
+            }
+            *link = obj->next_object;
+            bytes -= obj->allocated_size;
+            objects_count--;
+            kinds[obj->kind()].live--;
+            delete obj;
+        }
+    }
+
+public:
+    Heap() = default;
+    Heap(const Heap&) = delete;
+    Heap& operator=(const Heap&) = delete;
+
+    // Every allocation is a potential collection point, so the caller must
+    // keep any object it still needs reachable from a root before calling make.
+    template<class T, class... Args>
+    T* make(Args&&... args)
+    {
+        if(bytes >= next_collection)
+            collect();
+
+        auto obj = new T(std::forward<Args>(args)...);
+        obj->allocated_size = sizeof(T);
+        obj->next_object = objects;
+        objects = obj;
+        bytes += sizeof(T);
+        objects_count++;
+        peak = std::max(peak, bytes);
+        auto& stats = kinds[obj->kind()];
+        stats.live++;
+        stats.allocations++;
+        stats.bytes += sizeof(T);
+        return obj;
+    }
+
+    void mark(Collectable* obj)
+    {
+        if(!obj || obj->mark_epoch == epoch)
+            return;
+        obj->mark_epoch = epoch;
+        gray.push_back(obj);
+    }
+
+    void collect()
+    {
+        epoch = ++epochs;
+        for(auto root : roots)
+            mark(root);
+
+        while(!gray.empty())
+        {
+            auto obj = gray.back();
+            gray.pop_back();
+            obj->trace(*this);
+        }
+
+        sweep();
+        next_collection = std::max(threshold, bytes * GROWTH_FACTOR);
+        collections_count++;
+    }
+
+    void push_root(Collectable* obj) { roots.push_back(obj); }
+    std::size_t roots_size() const { return roots.size(); }
+    void truncate_roots(const std::size_t size) { roots.resize(size); }
+
+    void set_threshold(const std::size_t bytes_threshold)
+    {
+        threshold = bytes_threshold;
+        next_collection = bytes_threshold;
+    }
+
+    std::size_t bytes_allocated() const { return bytes; }
+    std::size_t live_objects() const { return objects_count; }
+    std::size_t collections() const { return collections_count; }
+    std::size_t peak_bytes() const { return peak; }
+    const KindStats& stats(const std::size_t kind) const { return kinds[kind]; }
+
+    ~Heap()
+    {
+        while(objects)
+        {
+            auto obj = objects;
+            objects = obj->next_object;
+            delete obj;
+        }
+    }
+};
+
+// Keeps every root pushed while it is alive on the heap's evaluation stack
+// and drops them all when the C++ scope that needed them ends.
+class RootScope
+{
+    Heap& heap;
+    const std::size_t size;
+public:
+    explicit RootScope(Heap& h) : heap(h), size(h.roots_size()) {}
+    RootScope(Heap& h, Collectable* obj) : RootScope(h) { heap.push_root(obj); }
+    void push_back(Collectable* obj) { heap.push_root(obj); }
+    // drops whatever was pushed since the scope began
+    void reset() { heap.truncate_roots(size); }
+    RootScope(const RootScope&) = delete;
+    RootScope& operator=(const RootScope&) = delete;
+    ~RootScope() { heap.truncate_roots(size); }
+};
+
+// The heap objects are made on by the running thread. Every thread starts
+// with one of its own, and an Interpreter swaps in the heap it owns while it
+// runs, so no two interpreters ever share one.
+inline thread_local Heap* current_heap = nullptr;
+
+inline Heap& thread_heap()
+{
+    thread_local Heap heap;
+    return heap;
+}
+
+inline Heap& heap()
+{
+    if(!current_heap) [[unlikely]]
+        current_heap = &thread_heap();
+    return *current_heap;
+}
+
+// Makes h the heap of the running thread while it is alive.
+class HeapScope
+{
+    Heap* const previous;
+public:
+    explicit HeapScope(Heap& h) : previous(current_heap) { current_heap = &h; }
+    HeapScope(const HeapScope&) = delete;
+    HeapScope& operator=(const HeapScope&) = delete;
+    ~HeapScope() { current_heap = previous; }
+};
+
+} // namespace gc
+#endif // GC_H
@@ -0,0 +1,88 @@
+#ifndef INTERNER_H
+#define INTERNER_H
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+// A name interned by an Interner. Every occurrence of the same text in an
+// interpreter gets the same Symbol, so two of them are compared, and hashed,
+// as the address of that text instead of its characters.
+class Symbol
+{
+    const std::string* text = nullptr;
+
+public:
+    Symbol() = default;
+    explicit Symbol(const std::string* t) : text(t) {}
+
+    const std::string& str() const { return *text; }
+    std::string_view view() const { return *text; }
+    const void* address() const { return text; }
+
+    explicit operator bool() const { return text != nullptr; }
+    bool operator==(const Symbol&) const = default;
+};
+
+template<>
+struct std::hash<Symbol>
+{
+    std::size_t operator()(const Symbol symbol) const { return std::hash<const void*>{}(symbol.address()); }
+};
+
+// The texts of the names an interpreter has seen. They are only ever added,
+// and the set keeps every one at the same address, so the Symbols handed out
+// stay valid for as long as the Interner does.
+class Interner
+{
+    // lets names that point into the source be looked up without a copy
+    struct Hash
+    {
+        using is_transparent = void;
+        std::size_t operator()(const std::string_view text) const { return std::hash<std::string_view>{}(text); }
+    };
+
+    std::unordered_set<std::string, Hash, std::equal_to<>> texts;
+
+public:
+    Interner() = default;
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    Symbol intern(const std::string_view text)
+    {
+        auto it = texts.find(text);
+        if(it == texts.end())
+            it = texts.emplace(text).first;
+        return Symbol(&*it);
+    }
+
+    // The symbol of text if it was ever interned, an empty one otherwise.
+    Symbol find(const std::string_view text) const
+    {
+        auto it = texts.find(text);
+        return it == texts.end() ? Symbol() : Symbol(&*it);
+    }
+
+    std::size_t size() const { return texts.size(); }
+};
+
+// The interner of the running thread, swapped by an Interpreter the same
+// way as gc::current_heap. Every thread starts with one of its own.
+inline thread_local Interner* current_interner = nullptr;
+
+inline Interner& thread_interner()
+{
+    thread_local Interner names;
+    return names;
+}
+
+inline Interner& interner()
+{
+    if(!current_interner) [[unlikely]]
+        current_interner = &thread_interner();
+    return *current_interner;
+}
+
+#endif // INTERNER_H
@@ -0,0 +1,132 @@
+#include "interpreter.h"
+#include "ast.h"
+#include "builtin.h"
+#include "evaluator.h"
+#include "folder.h"
+#include "gc.h"
+#include "lexer.h"
+#include "object.h"
+#include "parser.h"
+#include "profiler.h"
+#include "stack_evaluator.h"
+#include "vm.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+
+using namespace std;
+using ast::Program;
+
+// Installs the interner, the heap, the builtins and the profiler of an
+// interpreter on the running thread, and puts back whatever was there before
+// when it goes away.
+class Enter
+{
+    gc::HeapScope heap;
+    Interner* const previous_interner;
+    Builtins* const previous_builtins;
+    Profiler* const previous_profiler;
+public:
+    Enter(Interner& i, gc::Heap& h, Builtins& b, Profiler* p)
+        : heap(h), previous_interner(current_interner), previous_builtins(current_builtins), previous_profiler(current_profiler)
+    {
+        current_interner = &i;
+        current_builtins = &b;
+        current_profiler = p;
+    }
+    Enter(const Enter&) = delete;
+    Enter& operator=(const Enter&) = delete;
+    ~Enter()
+    {
+        current_interner = previous_interner;
+        current_builtins = previous_builtins;
+        current_profiler = previous_profiler;
+    }
+};
+
+Interpreter::Interpreter(const Options& options)
+{
+    heap.set_threshold(options.gc_threshold);
+    if(options.engine == Engine::VM)
+        vm = make_unique<VM>();
+    else
+        globals = make_unique<obj::Environment>();
+    if(options.engine == Engine::STACK)
+        stack_evaluator = make_unique<StackEvaluator>(options.max_depth);
+    if(!options.profile.empty())
+        sampler = make_unique<Profiler>();
+
+    // the globals stay reachable between runs, while the host makes values
+    if(vm)
+        heap.push_root(vm.get());
+    else
+        heap.push_root(globals.get());
+}
+
+Program* Interpreter::compile(string source)
+{
+    auto program = programs.new_program(std::move(source));
+    return parse(program, program->source);
+}
+
+Program* Interpreter::compile_in_place(string_view source)
+{
+    return parse(programs.new_program(string()), source);
+}
+
+Program* Interpreter::parse(Program* program, string_view source)
+{
+    Lexer lexer(source);
+    Parser parser(lexer, program->arena);
+    program->statements = parser.parse_program();
+    errors_list = std::move(parser.errors());
+    if(!errors_list.empty())
+        return nullptr;
+
+    ConstantFolder().fold(program);
+    return program;
+}
+
+Value Interpreter::run(Program* program)
+{
+    Enter enter(names, heap, builtin_table, sampler.get());
+
+    if(vm)
+        return vm->run(program);
+
+    if(stack_evaluator)
+        return stack_evaluator->run(program, globals.get());
+    return ::evaluate(program, globals.get());
+}
+
+Value Interpreter::run(string source)
+{
+    auto program = compile(std::move(source));
+    return program ? run(program) : nullptr;
+}
+
+Value Interpreter::run_in_place(string_view source)
+{
+    auto program = compile_in_place(source);
+    return program ? run(program) : nullptr;
+}
+
+void Interpreter::set(string_view name, Value value)
+{
+    auto& env = environment();
+    auto slot = env.symbols->define(names.intern(name));
+    env.grow();
+    env.slots[slot] = value;
+}
+
+Value Interpreter::get(string_view name)
+{
+    auto symbol = names.find(name);
+    return symbol ? environment().find(symbol) : nullptr;
+}
+
+Value Interpreter::make_string(string value)
+{
+    return heap.make<obj::String>(std::move(value));
+}
@@ -0,0 +1,105 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+#include "ast.h"
+#include "binding.h"
+#include "builtin.h"
+#include "gc.h"
+#include "interner.h"
+#include "object.h"
+#include "profiler.h"
+#include "stack_evaluator.h"
+#include "vm.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How the command line asked programs to be run, shared by scripts and the REPL.
+enum class Engine
+{
+    TREE_WALKER,
+    STACK,
+    VM
+};
+
+struct Options
+{
+    Engine engine = Engine::TREE_WALKER;
+    std::size_t max_depth = StackEvaluator::DEFAULT_MAX_DEPTH;
+    std::size_t gc_threshold = gc::Heap::DEFAULT_THRESHOLD;
+    // where to write the collapsed stacks sampled while running, empty to
+    // not profile at all
+    std::string profile;
+    // print what the heap made when the program ends
+    bool stats = false;
+};
+
+// One independent instance of the language. It owns its heap, its globals,
+// its builtins and the programs it ran, and shares nothing mutable with any
+// other instance, so separate threads can each run their own interpreter
+// without locking. A single interpreter is used by one thread at a time.
+// The values it returns live on its heap and die with it; a value the host
+// wants to keep across runs has to be stored in a global with set, since any
+// run may collect the rest.
+class Interpreter
+{
+    // the names of its programs and builtins, outliving every table keyed by them
+    Interner names;
+    gc::Heap heap;
+    Builtins builtin_table{names};
+    // the functions a program defines point into its tree
+    ast::Programs_Guard programs;
+    std::unique_ptr<obj::Environment> globals;
+    std::unique_ptr<VM> vm;
+    std::unique_ptr<StackEvaluator> stack_evaluator;
+    std::unique_ptr<Profiler> sampler;
+    std::vector<std::string> errors_list;
+
+    ast::Program* parse(ast::Program*, std::string_view);
+    obj::Environment& environment() { return vm ? vm->environment() : *globals; }
+
+public:
+    explicit Interpreter(const Options& options = {});
+    Interpreter(const Interpreter&) = delete;
+    Interpreter& operator=(const Interpreter&) = delete;
+
+    // Parses source into a program that run can execute any number of
+    // times. When it does not parse, returns nullptr and errors() says why.
+    // The program belongs to the interpreter.
+    ast::Program* compile(std::string source);
+    // Same as compile, without copying source, which must outlive the interpreter.
+    ast::Program* compile_in_place(std::string_view source);
+    // Runs a program made by compile with the globals left by the programs
+    // run before.
+    obj::Value run(ast::Program* program);
+
+    // compile and run in one go, nullptr when source does not parse.
+    obj::Value run(std::string source);
+    obj::Value run_in_place(std::string_view source);
+
+    // The parser errors of the last program compiled.
+    const std::vector<std::string>& errors() const { return errors_list; }
+
+    // Globals the host shares with its programs. get returns nullptr for a
+    // name that was never set.
+    void set(std::string_view name, obj::Value value);
+    obj::Value get(std::string_view name);
+
+    // A string on this heap, for the host to pass to its programs. Like any
+    // new object it must be stored with set before anything else is made.
+    obj::Value make_string(std::string value);
+
+    // Makes fn callable from this interpreter's programs as name, replacing
+    // the builtin of that name if there is one.
+    void define(std::string_view name, const BuiltinFunction& fn) { builtin_table.define(name, fn); }
+    // Same as define, for a plain function bound with bind<F>.
+    template<auto F>
+    void define(std::string_view name) { builtin_table.define(name, bind<F>(std::string(name))); }
+    Builtins& builtins() { return builtin_table; }
+    const gc::Heap& memory() const { return heap; }
+    // nullptr unless the options asked for a profile
+    const Profiler* profiler() const { return sampler.get(); }
+};
+
+#endif // INTERPRETER_H
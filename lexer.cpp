@@ -13,7 +13,7 @@ bool is_number(char);
 bool is_identifier(char);
 bool skip_whitespace(char,int&);
 
-Lexer::Lexer(const string& src)
+Lexer::Lexer(string_view src)
     : source(src), current_char(' '), read_position(0), position(0), line(1) {}
 
  void Lexer::read_character()
@@ -103,45 +103,51 @@ Lexer::Lexer(const string& src)
         case '=':
             if(peek_character() == '=')
             {   read_position++;
-                return Token { TokenType::EQ, "==", line, 2 }; }
-            return Token { TokenType::ASSIGN, &current_char, line };
+                return Token { TokenType::EQ, source.substr(position, 2), line }; }
+            return Token { TokenType::ASSIGN, source.substr(position, 1), line };
         case '+':
-            return Token { TokenType::PLUS, &current_char, line };
+            return Token { TokenType::PLUS, source.substr(position, 1), line };
         case '-':
-            return Token { TokenType::MINUS, &current_char, line };
+            return Token { TokenType::MINUS, source.substr(position, 1), line };
         case '/':
-            return Token { TokenType::DIVISION, &current_char, line };
+            return Token { TokenType::DIVISION, source.substr(position, 1), line };
         case '*':
-            return Token { TokenType::MULTIPLICATION, &current_char, line };
+            return Token { TokenType::MULTIPLICATION, source.substr(position, 1), line };
         case '!':
             if(peek_character() == '=')
             {   read_position++;
-                return Token { TokenType::NOT_EQ, "!=", line, 2 }; }
-            return Token { TokenType::NEGATION, &current_char, line };
+                return Token { TokenType::NOT_EQ, source.substr(position, 2), line }; }
+            return Token { TokenType::NEGATION, source.substr(position, 1), line };
         case '<':
-            return Token { TokenType::LT, &current_char, line };
+            return Token { TokenType::LT, source.substr(position, 1), line };
         case '>':
-            return Token { TokenType::GT, &current_char, line };
+            return Token { TokenType::GT, source.substr(position, 1), line };
         case '(':
-            return Token { TokenType::LPAREN, &current_char, line };
+            return Token { TokenType::LPAREN, source.substr(position, 1), line };
         case ')':
-            return Token { TokenType::RPAREN, &current_char, line };
+            return Token { TokenType::RPAREN, source.substr(position, 1), line };
         case '{':
-            return Token { TokenType::LBRACE, &current_char, line };
+            return Token { TokenType::LBRACE, source.substr(position, 1), line };
         case '}':
-            return Token { TokenType::RBRACE, &current_char, line };
+            return Token { TokenType::RBRACE, source.substr(position, 1), line };
+        case '[':
+            return Token { TokenType::LBRACKET, source.substr(position, 1), line };
+        case ']':
+            return Token { TokenType::RBRACKET, source.substr(position, 1), line };
         case ',':
-            return Token { TokenType::COMMA, &current_char, line };
+            return Token { TokenType::COMMA, source.substr(position, 1), line };
         case ';':
-            return Token { TokenType::SEMICOLON, &current_char, line };
+            return Token { TokenType::SEMICOLON, source.substr(position, 1), line };
+        case ':':
+            return Token { TokenType::COLON, source.substr(position, 1), line };
         case '\"':
             return read_string('\"');
         case '\'':
             return read_string('\'');
         case '\0':
-            return Token { TokenType::_EOF, &current_char, line };
+            return Token { TokenType::_EOF, string_view("", 1), line };
         default:
-            return Token { TokenType::ILLEGAL, &current_char, line };
+            return Token { TokenType::ILLEGAL, source.substr(position, 1), line };
     }
 }
 
@@ -154,7 +160,7 @@ Token Lexer::read_identifier()
     else end = &source.at(position);
     read_position = position;
 
-    return keyword(string(begin, end));
+    return keyword(string_view(begin, static_cast<size_t>(end - begin)));
 }
 
 Token Lexer::read_number()
@@ -173,7 +179,7 @@ Token Lexer::read_string(char quote)
 {
     read_character();
     if(current_char == quote)
-        return Token { TokenType::STRING, string(""), line};
+        return Token { TokenType::STRING, string_view(), line};
 
     const char* begin = &source.at(position);
     const char* end = begin;
@@ -198,9 +204,10 @@ static constexpr array<pair<string_view, TokenType>, 8> keyword_values {{
     {"si_no", TokenType::ELSE},
     {"verdadero", TokenType::_TRUE},
     {"falso", TokenType::_FALSE},
+    {"mientras", TokenType::WHILE}
 }};
 
-Token Lexer::keyword(const string& s) const
+Token Lexer::keyword(string_view s) const
 {
     static constexpr auto keywords = Map<string_view, TokenType, keyword_values.size()>{{keyword_values}};
 
@@ -3,25 +3,27 @@
 #include "token.h"
 #include <cstddef>
 #include <string>
+#include <string_view>
 
 class Lexer
 {
 private:
-    const std::string source;
+    // not owned, see ast::Program::source
+    std::string_view source;
     char current_char;
     std::size_t read_position;
     std::size_t position;
     int line;
 
     void read_character();
-    Token keyword(const std::string&) const;
+    Token keyword(std::string_view) const;
     Token read_string(char);
     Token read_identifier();
     Token read_number();
     char peek_character() const;
 
 public:
-    explicit Lexer(const std::string&);
+    explicit Lexer(std::string_view);
     Token next_token();
     
 };
@@ -1,10 +1,41 @@
+#include "script.h"
+#include <cstdlib>
 #include <iostream>
+#include <string_view>
 using namespace std;
-void start_repl();
+void start_repl(const Options&);
 
-int main()
+static constexpr string_view GC_THRESHOLD_FLAG = "--gc-threshold=";
+static constexpr string_view VM_FLAG = "--vm";
+static constexpr string_view STACK_FLAG = "--stack";
+static constexpr string_view MAX_DEPTH_FLAG = "--max-depth=";
+static constexpr string_view PROFILE_FLAG = "--profile=";
+static constexpr string_view STATS_FLAG = "--stats";
+
+int main(int argc, char* argv[])
 {
+    Options options;
+    for(int i = 1; i < argc; i++)
+    {
+        string_view arg = argv[i];
+        if(arg.starts_with(GC_THRESHOLD_FLAG))
+            options.gc_threshold = strtoull(arg.substr(GC_THRESHOLD_FLAG.size()).data(), nullptr, 10);
+        else if(arg == VM_FLAG)
+            options.engine = Engine::VM;
+        else if(arg == STACK_FLAG)
+            options.engine = Engine::STACK;
+        else if(arg.starts_with(MAX_DEPTH_FLAG))
+            options.max_depth = strtoull(arg.substr(MAX_DEPTH_FLAG.size()).data(), nullptr, 10);
+        else if(arg.starts_with(PROFILE_FLAG))
+            options.profile = arg.substr(PROFILE_FLAG.size());
+        else if(arg == STATS_FLAG)
+            options.stats = true;
+        else if(!arg.starts_with("--"))
+            // everything after the script belongs to the script
+            return run_script(argv[i], options);
+    }
+
     cout << "Bienvenido al Lenguaje de Programación Platzi.\n";
     cout << "Escribe una oración para comenzar.\n";
-    start_repl();
-}
\ No newline at end of file
+    start_repl(options);
+}
@@ -2,18 +2,26 @@
 #define OBJECT_H
 #include <cstddef>
 #include <map>
+#include <span>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
 #include <vector>
 #include "ast.h"
 #include "parser.h"
 #include "token.h"
 #include "utils.h"
+#include "gc.h"
+#include "symbol_table.h"
+#include <cstdint>
 #include <functional>
 
 using ast::Identifier;
 using ast::Block;
 
+namespace code { struct CompiledFunction; }
+
 namespace obj
 {
 enum class ObjectType
@@ -21,27 +29,41 @@ enum class ObjectType
     BOOLEAN,
     INTEGER,
     _NULL,
-    RETURN,
     ERROR,
     FUNCTION,
     STRING,
-    BUILTIN
+    BUILTIN,
+    ARRAY,
+    HASH
 };
 
-static constexpr std::array<const NameValuePair<ObjectType>, 8> objects_enums_string {{
+static constexpr std::array<const NameValuePair<ObjectType>, 9> objects_enums_string {{
     {ObjectType::BOOLEAN, "BOOLEAN"},
     {ObjectType::INTEGER, "INTEGER"},
     {ObjectType::_NULL, "NULL"},
-    {ObjectType::RETURN, "RETURN"},
     {ObjectType::ERROR, "ERROR"},
     {ObjectType::FUNCTION, "FUNCTION"},
     {ObjectType::STRING, "STRING"},
-    {ObjectType::BUILTIN, "BUILTIN"}
+    {ObjectType::BUILTIN, "BUILTIN"},
+    {ObjectType::ARRAY, "ARRAY"},
+    {ObjectType::HASH, "HASH"}
 }};
 
-class Object
+// The heap counts objects by ObjectType, and environments after them.
+inline constexpr std::size_t ENVIRONMENT_KIND = objects_enums_string.size();
+static_assert(ENVIRONMENT_KIND < gc::Collectable::KINDS);
+
+inline std::string_view kind_name(const std::size_t kind)
+{
+    if(kind == ENVIRONMENT_KIND)
+        return "ENVIRONMENT";
+    return kind < ENVIRONMENT_KIND ? objects_enums_string[kind].name : "OTHER";
+}
+
+class Object : public gc::Collectable
 {
 public:
+    std::size_t kind() const override { return static_cast<std::size_t>(type()); }
     virtual ObjectType type() const = 0;
     virtual std::string inspect() const = 0;
     virtual std::string_view type_string() const = 0;
@@ -53,42 +75,56 @@ public:
     Object& operator=(Object&&) = delete;
 };
 
-class Integer : public Object
+// A single machine word holding either a heap Object pointer or one of the
+// inline values. Objects are at least 8 byte aligned, so the low bits tell
+// them apart:
+//   ...000  pointer to an Object (all zero means no value at all)
+//   ...xx1  63 bit integer, stored shifted left by one
+//   ...010  nulo, falso or verdadero
+class Value
 {
-public:
-    const std::size_t value;
-    explicit Integer(const std::size_t v) : value(v) {}
-    ObjectType type() const override { return ObjectType::INTEGER; }
-    std::string inspect() const override { return std::to_string(value); }
-    std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::INTEGER); }
-};
+    static constexpr std::uintptr_t INTEGER_TAG = 0x1;
+    static constexpr std::uintptr_t SPECIAL_MASK = 0x7;
+    static constexpr std::uintptr_t SPECIAL_TAG = 0x2;
+    static constexpr std::uintptr_t NULL_BITS = 0x02;
+    static constexpr std::uintptr_t FALSE_BITS = 0x0A;
+    static constexpr std::uintptr_t TRUE_BITS = 0x12;
 
-class Boolean : public Object
-{
-public:
-    const bool value;
-    explicit Boolean(bool v) : value(v) {}
-    ObjectType type() const override { return ObjectType::BOOLEAN; }
-    std::string inspect() const override { return value ? "verdadero" : "falso"; }
-    std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::BOOLEAN); }
-};
+    std::uintptr_t bits;
+    constexpr explicit Value(std::uintptr_t b, int) : bits(b) {}
 
-class Null : public Object
-{
 public:
-    ObjectType type() const override { return ObjectType::_NULL;}
-    std::string inspect() const override { return "nulo"; }
-    std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::_NULL); }
-};
+    constexpr Value() : bits(0) {}
+    constexpr Value(std::nullptr_t) : bits(0) {}
+    Value(Object* obj) : bits(reinterpret_cast<std::uintptr_t>(obj)) {}
 
-class Return : public Object
-{
-public:
-    Object* value;
-    explicit Return(Object* v) : value(v) {}
-    ObjectType type() const override { return ObjectType::RETURN; }
-    std::string inspect() const override { return value->inspect(); }
-    std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::RETURN); }
+    static constexpr Value integer(const std::int64_t v)
+    {
+        return Value((static_cast<std::uintptr_t>(v) << 1) | INTEGER_TAG, 0);
+    }
+    static constexpr Value boolean(const bool v) { return Value(v ? TRUE_BITS : FALSE_BITS, 0); }
+    static constexpr Value null() { return Value(NULL_BITS, 0); }
+
+    constexpr bool is_integer() const { return bits & INTEGER_TAG; }
+    constexpr bool is_boolean() const { return bits == TRUE_BITS || bits == FALSE_BITS; }
+    constexpr bool is_null() const { return bits == NULL_BITS; }
+    constexpr bool is_object() const { return bits != 0 && (bits & SPECIAL_MASK) == 0; }
+
+    constexpr std::int64_t as_integer() const { return static_cast<std::int64_t>(bits) >> 1; }
+    constexpr bool as_boolean() const { return bits == TRUE_BITS; }
+    Object* as_object() const { return reinterpret_cast<Object*>(bits); }
+    template<class T>
+    T* as() const { return static_cast<T*>(as_object()); }
+    // the object, or nullptr for inline values, ready to be pushed as a gc root
+    Object* object() const { return is_object() ? as_object() : nullptr; }
+
+    ObjectType type() const;
+    std::string inspect() const;
+    std::string_view type_string() const;
+
+    constexpr explicit operator bool() const { return bits != 0; }
+    constexpr bool operator==(const Value& other) const { return bits == other.bits; }
+    constexpr bool operator==(std::nullptr_t) const { return bits == 0; }
 };
 
 class Error : public Object
@@ -101,42 +137,117 @@ public:
     std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::ERROR); }
 };
 
-class Environment
+// One slot per name declared in the scope's SymbolTable, left empty until
+// the declaration runs. A global environment owns its table, since every
+// program evaluated in it may declare new names.
+class Environment : public gc::Collectable
 {
-    std::map<std::string, Object*> store;
-    Environment* outer = nullptr;
+    std::unique_ptr<SymbolTable> global_symbols;
 public:
-    Environment() = default;
-    explicit Environment(Environment* outer) : outer(outer) { }
-    void set_item(const std::string& key, Object* value) { store[key] = value; }
-    void del_item(const std::string& key){ store.erase(key); }
+    std::vector<Value> slots;
+    Environment* outer = nullptr;
+    SymbolTable* symbols;
+    // set once a function closes over this scope, which then has to outlive
+    // the call that made it
+    bool captured = false;
+    // made by an EnvironmentPool rather than on the heap
+    bool pooled = false;
 
-    Object* get_item(const std::string& key)
+    Environment() : global_symbols(std::make_unique<SymbolTable>()), symbols(global_symbols.get()) {}
+    Environment(Environment* outer, SymbolTable* symbols)
+        : slots(symbols->size()), outer(outer), symbols(symbols) {}
+
+    std::size_t kind() const override { return ENVIRONMENT_KIND; }
+
+    void trace(gc::Heap& heap) override
     {
-        if(store[key])
-            return store[key];
-        else
-            return outer->get_item(key);
+        for(auto value : slots)
+            heap.mark(value.object());
+        heap.mark(outer);
+    }
+
+    // Lets a tail call into a function with the same table run in this
+    // environment instead of a new one.
+    bool reusable_for(const SymbolTable* table) const { return symbols == table && !captured; }
+
+    void reuse(Environment* new_outer) { reuse(new_outer, symbols); }
+
+    void reuse(Environment* new_outer, SymbolTable* table)
+    {
+        symbols = table;
+        slots.assign(symbols->size(), nullptr);
+        outer = new_outer;
+        captured = false;
     }
 
-    bool item_exist(const std::string& key)
+    // Makes room for the names a program just declared in the global table.
+    void grow() { slots.resize(symbols->size()); }
+
+    // Looks a name up through the tables of the scopes. Only needed for a
+    // slot read before its declaration ran, or for a name no scope declared.
+    Value find(const Symbol name) const
     {
-        if(store.find(key) != store.end())
-            return true;
-        else if(outer && outer->item_exist(key))
-            return true;
-        return false;
+        for(auto env = this; env; env = env->outer)
+        {
+            std::size_t slot = 0;
+            if(env->symbols->find(name, slot) && slot < env->slots.size() && env->slots[slot])
+                return env->slots[slot];
+        }
+        return nullptr;
+    }
+};
+
+// Environments for calls into functions that make no closures, which nothing
+// can refer to once the call returns. The engines hand them back when the
+// call ends and the next call reuses them, slots and all, instead of making
+// one on the heap per call and leaving it to the collector. While in use they
+// are kept alive and traced from the frames of the engine, like the heap's.
+class EnvironmentPool
+{
+    // how many environments are kept for reuse; deeper recursion frees the rest
+    static constexpr std::size_t CAPACITY = 1024;
+    std::vector<std::unique_ptr<Environment>> available;
+
+public:
+    Environment* acquire(Environment* outer, SymbolTable* symbols)
+    {
+        if(available.empty())
+        {
+            auto env = new Environment(outer, symbols);
+            env->pooled = true;
+            return env;
+        }
+        auto env = available.back().release();
+        available.pop_back();
+        env->reuse(outer, symbols);
+        return env;
+    }
+
+    // Environments made on the heap are left to the collector.
+    void release(Environment* env)
+    {
+        if(!env->pooled)
+            return;
+        if(available.size() < CAPACITY)
+            available.emplace_back(env);
+        else
+            delete env;
     }
 };
 
 class Function : public Object
 {
 public:
-    std::vector<Identifier*> parameters;
+    ast::NodeList<Identifier> parameters;
     Block* body;
     Environment* env;
-    Function(const std::vector<Identifier*>& params, Block* b, Environment* env )
-        : parameters(params), body(b), env(env) {}
+    SymbolTable* symbols;
+    // the literal it was made from, which names it in profiles
+    const ast::Function* definition;
+    Function(const ast::NodeList<Identifier>& params, Block* b, Environment* env, SymbolTable* symbols,
+             const ast::Function* definition = nullptr)
+        : parameters(params), body(b), env(env), symbols(symbols), definition(definition) {}
+    void trace(gc::Heap& heap) override { heap.mark(env); }
     ObjectType type() const override { return ObjectType::FUNCTION; }
     std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::FUNCTION); }
     std::string inspect() const override
@@ -145,22 +256,274 @@ public:
     }
 };
 
+class Closure : public Object
+{
+public:
+    const code::CompiledFunction* function;
+    Environment* env;
+    Closure(const code::CompiledFunction* fn, Environment* env) : function(fn), env(env) {}
+    void trace(gc::Heap& heap) override { heap.mark(env); }
+    ObjectType type() const override { return ObjectType::FUNCTION; }
+    std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::FUNCTION); }
+    std::string inspect() const override
+    {
+       return "Función";
+    }
+};
+
+// Either flat text or the concatenation of two other Strings, a rope node
+// that `+` makes without copying either side once the result is long enough.
+// A rope is flattened the first time its text is needed, and then lets go of
+// its parts, so a string built by appending to itself N times costs O(N)
+// instead of copying every intermediate result. Its length is always known.
 class String : public Object
 {
+    mutable std::string text;
+    // both set while this is a rope, nullptr once flat
+    mutable String* left = nullptr;
+    mutable String* right = nullptr;
+    const std::size_t length;
+    // computed on first use as a hash key, never 0 once it is
+    mutable std::size_t hash_value = 0;
+
+    void flatten() const
+    {
+        std::string flat;
+        flat.reserve(length);
+        // the parts still to copy, leftmost last, without recursing
+        std::vector<const String*> parts {right, left};
+        while(!parts.empty())
+        {
+            auto part = parts.back();
+            parts.pop_back();
+            if(part->left)
+            {
+                parts.push_back(part->right);
+                parts.push_back(part->left);
+            }
+            else
+                flat += part->text;
+        }
+        text = std::move(flat);
+        left = right = nullptr;
+    }
+
 public:
-    const std::string value;
-    explicit String(const std::string& v) : value(v) {}
+    // results shorter than this are copied flat, a rope node is not worth it
+    static constexpr std::size_t MIN_ROPE_LENGTH = 64;
+
+    explicit String(std::string v) : text(std::move(v)), length(text.size()) {}
+    String(String* l, String* r) : left(l), right(r), length(l->length + r->length) {}
+
+    const std::string& value() const
+    {
+        if(left)
+            flatten();
+        return text;
+    }
+    std::size_t size() const { return length; }
+    bool is_rope() const { return left != nullptr; }
+
+    std::size_t hash() const
+    {
+        if(!hash_value)
+            hash_value = std::hash<std::string>{}(value()) | 1;
+        return hash_value;
+    }
+    void trace(gc::Heap& heap) override
+    {
+        heap.mark(left);
+        heap.mark(right);
+    }
     ObjectType type() const override { return ObjectType::STRING; }
-    std::string inspect() const override { return value; }
+    std::string inspect() const override { return value(); }
     std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::STRING); }
 };
 
-using BuiltinFunction = std::function<Object*(const std::vector<Object*>&, const int)>;
+// The elements are stored contiguously, so the builtins working on whole
+// arrays copy them in bulk instead of evaluating anything per element.
+class Array : public Object
+{
+public:
+    std::vector<Value> elements;
+    Array() = default;
+    explicit Array(std::vector<Value>&& e) : elements(std::move(e)) {}
+    void trace(gc::Heap& heap) override
+    {
+        for(auto element : elements)
+            heap.mark(element.object());
+    }
+    ObjectType type() const override { return ObjectType::ARRAY; }
+    std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::ARRAY); }
+    std::string inspect() const override;
+};
+
+// Open addressing table with linear probing, keyed by integers, booleans and
+// strings. The hash of every slot lives in its own dense array, 0 meaning
+// empty, so a probe reads 4 bytes per slot and only compares keys whose
+// hashes match. Removing shifts the entries that follow back instead of
+// leaving tombstones, so lookups never slow down after deletions.
+class Hash : public Object
+{
+    struct Entry
+    {
+        Value key;
+        Value value;
+    };
+
+    static constexpr std::size_t MIN_CAPACITY = 8;
+    static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+    std::vector<std::uint32_t> hashes;
+    std::vector<Entry> entries;
+    std::size_t count = 0;
+
+    static std::uint32_t hash_of(Value key)
+    {
+        std::uint64_t h = 0;
+        if(key.is_object())
+            h = key.as<String>()->hash();
+        else if(key.is_boolean())
+            h = key.as_boolean() ? 0x9e3779b97f4a7c15ULL : 0x632be59bd9b4e019ULL;
+        else
+            h = static_cast<std::uint64_t>(key.as_integer());
+
+        // the table only looks at the low bits, so every bit is mixed into them
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        auto folded = static_cast<std::uint32_t>(h);
+        return folded ? folded : 1;
+    }
+
+    static bool same_key(Value a, Value b)
+    {
+        if(a == b)
+            return true;
+        return a.is_object() && b.is_object() && a.as<String>()->value() == b.as<String>()->value();
+    }
+
+    std::size_t find(Value key, const std::uint32_t h) const
+    {
+        if(hashes.empty())
+            return NOT_FOUND;
+        const auto mask = hashes.size() - 1;
+        for(auto i = h & mask; hashes[i]; i = (i + 1) & mask)
+            if(hashes[i] == h && same_key(entries[i].key, key))
+                return i;
+        return NOT_FOUND;
+    }
+
+    void insert_new(Value key, Value value, const std::uint32_t h)
+    {
+        const auto mask = hashes.size() - 1;
+        auto i = h & mask;
+        while(hashes[i])
+            i = (i + 1) & mask;
+        hashes[i] = h;
+        entries[i] = {key, value};
+        count++;
+    }
+
+    void grow()
+    {
+        auto old_hashes = std::move(hashes);
+        auto old_entries = std::move(entries);
+        auto capacity = old_hashes.empty() ? MIN_CAPACITY : old_hashes.size() * 2;
+        hashes.assign(capacity, 0);
+        entries.assign(capacity, {});
+        count = 0;
+        for(std::size_t i = 0; i < old_hashes.size(); i++)
+            if(old_hashes[i])
+                insert_new(old_entries[i].key, old_entries[i].value, old_hashes[i]);
+    }
+
+public:
+    // integers, booleans and strings
+    static bool hashable(Value key)
+    {
+        return key.is_integer() || key.is_boolean() || (key.is_object() && key.as_object()->type() == ObjectType::STRING);
+    }
+
+    // The value stored for key, or nullptr when there is none. Keys must be hashable.
+    Value get(Value key) const
+    {
+        auto i = find(key, hash_of(key));
+        return i == NOT_FOUND ? nullptr : entries[i].value;
+    }
+
+    void set(Value key, Value value)
+    {
+        auto h = hash_of(key);
+        auto i = find(key, h);
+        if(i != NOT_FOUND)
+        {
+            entries[i].value = value;
+            return;
+        }
+        // at most three quarters full
+        if(4 * (count + 1) > 3 * hashes.size())
+            grow();
+        insert_new(key, value, h);
+    }
+
+    bool remove(Value key)
+    {
+        auto i = find(key, hash_of(key));
+        if(i == NOT_FOUND)
+            return false;
+
+        const auto mask = hashes.size() - 1;
+        for(auto j = (i + 1) & mask; hashes[j]; j = (j + 1) & mask)
+        {
+            // an entry moves into the hole unless its home slot lies after the hole
+            auto home = hashes[j] & mask;
+            bool movable = i <= j ? (home <= i || home > j) : (home <= i && home > j);
+            if(!movable)
+                continue;
+            hashes[i] = hashes[j];
+            entries[i] = entries[j];
+            i = j;
+        }
+        hashes[i] = 0;
+        entries[i] = {};
+        count--;
+        return true;
+    }
+
+    std::size_t size() const { return count; }
+
+    void reserve(const std::size_t n)
+    {
+        while(4 * n > 3 * hashes.size())
+            grow();
+    }
+
+    void trace(gc::Heap& heap) override
+    {
+        for(std::size_t i = 0; i < hashes.size(); i++)
+        {
+            if(!hashes[i])
+                continue;
+            heap.mark(entries[i].key.object());
+            heap.mark(entries[i].value.object());
+        }
+    }
+    ObjectType type() const override { return ObjectType::HASH; }
+    std::string_view type_string() const override { return getNameForValue(objects_enums_string, ObjectType::HASH); }
+    std::string inspect() const override;
+};
+
+// Arguments arrive as a view of the caller's own stack or vector, so a call
+// copies nothing; they stay rooted for as long as the builtin runs.
+using BuiltinFunction = std::function<Value(std::span<const Value>, const int)>;
 
 class Builtin : public Object
 {
 public:
-    const BuiltinFunction& fn;
+    BuiltinFunction fn;
     explicit Builtin(const BuiltinFunction& builtin_fn) : fn(builtin_fn) {}
     ObjectType type() const override { return ObjectType::BUILTIN; }
     std::string inspect() const override { return "builtin function"; }
@@ -168,5 +531,61 @@ public:
     Builtin(const Builtin& cp) : fn(cp.fn) {}
 };
 
+inline ObjectType Value::type() const
+{
+    if(is_integer())
+        return ObjectType::INTEGER;
+    if(is_boolean())
+        return ObjectType::BOOLEAN;
+    if(is_null())
+        return ObjectType::_NULL;
+    return as_object()->type();
+}
+
+inline std::string Value::inspect() const
+{
+    if(is_integer())
+        return std::to_string(as_integer());
+    if(is_boolean())
+        return as_boolean() ? "verdadero" : "falso";
+    if(is_null())
+        return "nulo";
+    return as_object()->inspect();
+}
+
+inline std::string Array::inspect() const
+{
+    std::string out = "[";
+    for(std::size_t i = 0; i < elements.size(); i++)
+    {
+        if(i > 0)
+            out.append(", ");
+        out.append(elements[i].inspect());
+    }
+    return out + "]";
+}
+
+// In table order, which is not the order the keys were added in.
+inline std::string Hash::inspect() const
+{
+    std::string out = "{";
+    for(std::size_t i = 0; i < hashes.size(); i++)
+    {
+        if(!hashes[i])
+            continue;
+        if(out.size() > 1)
+            out.append(", ");
+        out.append(entries[i].key.inspect() + ": " + entries[i].value.inspect());
+    }
+    return out + "}";
+}
+
+inline std::string_view Value::type_string() const
+{
+    if(is_object())
+        return as_object()->type_string();
+    return getNameForValue(objects_enums_string, type());
+}
+
 } // namespace obj
 #endif // OBJECT_H
@@ -12,7 +12,12 @@
 using namespace std;
 using namespace ast;
 
-Parser::Parser(const Lexer& l) : lexer(l)
+Parser::Parser(const Lexer& l) : Parser(l, *new Arena())
+{
+    own_arena.reset(arena);
+}
+
+Parser::Parser(const Lexer& l, Arena& arena) : lexer(l), arena(&arena)
 {
     prefix_parse_fns = register_prefix_fns();
     infix_parse_fns = register_infix_fns();
@@ -45,9 +50,16 @@ Statement* Parser::parse_statement()
     return parse_expression_statements();
 }
 
+// Names a function literal after the variable it is bound to.
+static void name_function(Expression* value, const Identifier* name)
+{
+    if(value && name && value->type() == Node::Function)
+        static_cast<ast::Function*>(value)->name = name->value;
+}
+
 LetStatement* Parser::parse_let_statement()
 {
-    auto let_statement = make_unique<LetStatement>(current_token);
+    auto let_statement = arena->make<LetStatement>(current_token);
 
     if(!expected_token(TokenType::IDENT))
         return nullptr;
@@ -59,16 +71,17 @@ LetStatement* Parser::parse_let_statement()
 
     advance_tokens();
     let_statement->value = parse_expression(Precedence::LOWEST);
+    name_function(let_statement->value, let_statement->name);
 
     if(peek_token.token_type == TokenType::SEMICOLON)
         advance_tokens();
 
-    return let_statement.release();
+    return let_statement;
 }
 
 ReturnStatement* Parser::parse_return_statement()
 {
-    auto return_statement = make_unique<ReturnStatement>(current_token);
+    auto return_statement = arena->make<ReturnStatement>(current_token);
     advance_tokens();
 
     return_statement->return_value = parse_expression(Precedence::LOWEST);
@@ -76,22 +89,23 @@ ReturnStatement* Parser::parse_return_statement()
     if(peek_token.token_type == TokenType::SEMICOLON)
         advance_tokens();
 
-    return return_statement.release();
+    return return_statement;
 }
 
 ExpressionStatement* Parser::parse_expression_statements()
 {
-    auto expression_statement = make_unique<ExpressionStatement>(current_token);
+    auto expression_statement = arena->make<ExpressionStatement>(current_token);
 
     expression_statement->expression = parse_expression(Precedence::LOWEST);
     if(peek_token.token_type == TokenType::SEMICOLON)
         advance_tokens();
 
-    return expression_statement.release();
+    return expression_statement;
 }
 
 Expression* Parser::parse_expression(Precedence precedence)
 {
+    auto mark = pending.size();
     try
     {
         auto prefix_parse_fn = prefix_parse_fns[current_token.token_type];
@@ -110,78 +124,82 @@ Expression* Parser::parse_expression(Precedence precedence)
     {
         auto error = fmt::format("No se encontró ninguna función para parsear {} cerca de la línea {}\n", current_token.literal, current_token.line);
         errors_list.push_back(error);
+        pending.resize(mark);
         return nullptr;
     }
 }
 
 Block* Parser::parse_block()
 {
-    auto block_statement = make_unique<Block>(current_token, vector<Statement*>());
+    auto token = current_token;
+    auto mark = pending.size();
     advance_tokens();
 
     while (current_token.token_type != TokenType::RBRACE && current_token.token_type != TokenType::_EOF)
     {
         auto statement = parse_statement();
         if(statement)
-            block_statement->statements.push_back(statement);
+            pending.push_back(statement);
         advance_tokens();
     }
-    return block_statement.release();
+    return arena->make<Block>(token, take_pending<Statement>(mark));
 }
 
-vector<Identifier*> Parser::parse_function_parameters()
+NodeList<Identifier> Parser::parse_function_parameters()
 {
-    vector<Identifier*> params;
     if (peek_token.token_type == TokenType::RPAREN)
     {
         advance_tokens();
-        return params;
+        return {};
     }
+    auto mark = pending.size();
     advance_tokens();
-    auto identifier = new Identifier(current_token, current_token.literal);
-    params.push_back(identifier);
+    auto identifier = arena->make<Identifier>(current_token, current_token.literal);
+    pending.push_back(identifier);
 
     while (peek_token.token_type == TokenType::COMMA)
     {
         advance_tokens();
         advance_tokens();
-        auto identifiers = new Identifier(current_token, current_token.literal);
-        params.push_back(identifiers);
+        auto identifiers = arena->make<Identifier>(current_token, current_token.literal);
+        pending.push_back(identifiers);
     }
 
+    auto params = take_pending<Identifier>(mark);
     if(!expected_token(TokenType::RPAREN))
         return {};
 
     return params;
 }
 
-vector<Expression*> Parser::parse_call_arguments()
+NodeList<Expression> Parser::parse_expression_list(const TokenType& end)
 {
-    auto arguments = vector<Expression*>();
-    if (peek_token.token_type == TokenType::RPAREN)
+    if (peek_token.token_type == end)
     {
         advance_tokens();
-        return arguments;
+        return {};
     }
 
+    auto mark = pending.size();
     advance_tokens();
 
     Expression* expression;
     if ((expression = parse_expression(Precedence::LOWEST)))
-        arguments.push_back(expression);
+        pending.push_back(expression);
 
     while (peek_token.token_type == TokenType::COMMA)
     {
         advance_tokens();
         advance_tokens();
         if ((expression = parse_expression(Precedence::LOWEST)))
-            arguments.push_back(expression);
+            pending.push_back(expression);
     }
 
-    if (!expected_token(TokenType::RPAREN))
+    auto expressions = take_pending<Expression>(mark);
+    if (!expected_token(end))
         return {};
 
-    return arguments;
+    return expressions;
 }
 
 bool Parser::expected_token(const TokenType& tp)
@@ -224,11 +242,14 @@ PrefixParseFns Parser::register_prefix_fns()
         { TokenType::_NULL, parse_null},
         { TokenType::IDENT, parse_identifier },
         { TokenType::IF, parse_if },
+        { TokenType::WHILE, parse_while },
         { TokenType::INT, parse_integer },
         { TokenType::MINUS, parse_prefix_expression },
         { TokenType::NEGATION, parse_prefix_expression },
         { TokenType::LPAREN, parse_grouped_expression },
-        { TokenType::STRING, parse_string_literal }
+        { TokenType::STRING, parse_string_literal },
+        { TokenType::LBRACKET, parse_array_literal },
+        { TokenType::LBRACE, parse_hash_literal }
     };
 }
 
@@ -244,7 +265,8 @@ InfixParseFns Parser::register_infix_fns()
         { TokenType::NOT_EQ, parse_infix_expression },
         { TokenType::LT, parse_infix_expression },
         { TokenType::GT, parse_infix_expression },
-        { TokenType::LPAREN, parse_call }
+        { TokenType::LPAREN, parse_call },
+        { TokenType::LBRACKET, parse_index }
     };
 }
 
@@ -258,10 +280,11 @@ AssignStatement* Parser::parse_assign_statement()
     advance_tokens();
 
     auto value = parse_expression(Precedence::LOWEST);
+    name_function(value, name);
     if(peek_token.token_type == TokenType::SEMICOLON)
         advance_tokens();
 
-    return new AssignStatement(token, name, value);
+    return arena->make<AssignStatement>(token, name, value);
 }
 
 Precedence Parser::get_precedence(const TokenType& tp)
@@ -273,3 +296,9 @@ Precedence Parser::get_precedence(const TokenType& tp)
 
     return Precedence::LOWEST;
 }
+
+Operator Parser::get_operator(const TokenType& tp)
+{
+    static constexpr auto OPERATORS = Map<TokenType, Operator, operator_values.size()>{{operator_values}};
+    return OPERATORS.at(tp);
+}
@@ -1,8 +1,10 @@
 #ifndef PARSER_H
 #define PARSER_H
+#include "arena.h"
 #include "ast.h"
 #include "lexer.h"
 #include "token.h"
+#include <charconv>
 #include <cstddef>
 #include <cstdlib>
 #include <functional>
@@ -31,6 +33,13 @@ using ast::Call;
 using ast::StringLiteral;
 using ast::Null;
 using ast::AssignStatement;
+using ast::While;
+using ast::ArrayLiteral;
+using ast::Index;
+using ast::HashLiteral;
+using ast::ASTNode;
+using ast::NodeList;
+using ast::Operator;
 
 using PrefixParseFn = std::function<Expression*()>;
 using InfixParseFn = std::function<Expression*(Expression*)>;
@@ -46,10 +55,11 @@ enum class Precedence
     SUM,
     PRODUC,
     PREFIX,
-    CALL
+    CALL,
+    INDEX
 };
 
-static constexpr std::array<std::pair<TokenType, Precedence>, 9> precedence_values
+static constexpr std::array<std::pair<TokenType, Precedence>, 10> precedence_values
 {{
     { TokenType::EQ, Precedence::EQUALS },
     { TokenType::NOT_EQ, Precedence::EQUALS },
@@ -59,7 +69,21 @@ static constexpr std::array<std::pair<TokenType, Precedence>, 9> precedence_valu
     { TokenType::MINUS, Precedence::SUM },
     { TokenType::DIVISION, Precedence::PRODUC },
     { TokenType::MULTIPLICATION, Precedence::PRODUC },
-    { TokenType::LPAREN, Precedence::CALL }
+    { TokenType::LPAREN, Precedence::CALL },
+    { TokenType::LBRACKET, Precedence::INDEX }
+ }};
+
+static constexpr std::array<std::pair<TokenType, Operator>, 9> operator_values
+{{
+    { TokenType::PLUS, Operator::PLUS },
+    { TokenType::MINUS, Operator::MINUS },
+    { TokenType::MULTIPLICATION, Operator::MULTIPLICATION },
+    { TokenType::DIVISION, Operator::DIVISION },
+    { TokenType::EQ, Operator::EQ },
+    { TokenType::NOT_EQ, Operator::NOT_EQ },
+    { TokenType::LT, Operator::LT },
+    { TokenType::GT, Operator::GT },
+    { TokenType::NEGATION, Operator::NEGATION }
  }};
 
 class Parser
@@ -71,6 +95,19 @@ private:
     PrefixParseFns prefix_parse_fns;
     InfixParseFns infix_parse_fns;
     std::vector<std::string> errors_list;
+    std::unique_ptr<Arena> own_arena;
+    Arena* arena;
+    // children of the lists being parsed, the innermost list last
+    std::vector<ASTNode*> pending;
+
+    template<typename T>
+    NodeList<T> take_pending(const std::size_t mark)
+    {
+        auto first = pending.begin() + static_cast<std::ptrdiff_t>(mark);
+        auto list = NodeList<T>::copy(*arena, first, pending.end());
+        pending.resize(mark);
+        return list;
+    }
 
     Statement* parse_statement();
     LetStatement* parse_let_statement();
@@ -79,65 +116,71 @@ private:
     ExpressionStatement* parse_expression_statements();
     Expression* parse_expression(Precedence);
     Block* parse_block();
-    std::vector<Identifier*> parse_function_parameters();
-    std::vector<Expression*> parse_call_arguments();
+    NodeList<Identifier> parse_function_parameters();
+    NodeList<Expression> parse_expression_list(const TokenType&);
     bool expected_token(const TokenType&);
     void advance_tokens();
     void expected_token_error(const TokenType&);
     InfixParseFns register_infix_fns();
     PrefixParseFns register_prefix_fns();
     Precedence get_precedence(const TokenType&);
+    Operator get_operator(const TokenType&);
 
 public:
+    // Nodes are allocated in the given arena, usually the one of the Program
+    // receiving them. Without one they live as long as the parser.
     explicit Parser(const Lexer& l);
+    Parser(const Lexer& l, Arena& arena);
     std::vector<Statement*> parse_program();
     std::vector<std::string>& errors();
 
 private:
     PrefixParseFn parse_identifier = [&]() -> Expression*
     {
-        return new Identifier(current_token, current_token.literal);
+        return arena->make<Identifier>(current_token, current_token.literal);
     };
 
     PrefixParseFn parse_integer = [&]() -> Expression*
     {
-        return new Integer(current_token, static_cast<std::size_t>(std::stoi(current_token.literal)));
+        std::size_t value = 0;
+        std::from_chars(current_token.literal.data(), current_token.literal.data() + current_token.literal.size(), value);
+        return arena->make<Integer>(current_token, value);
     };
 
     PrefixParseFn parse_prefix_expression = [&]() -> Expression*
     {
-        auto prefix_expression = std::make_unique<Prefix>(current_token, current_token.literal);
+        auto prefix_expression = arena->make<Prefix>(current_token, current_token.literal, get_operator(current_token.token_type));
 
         advance_tokens();
         prefix_expression->right = parse_expression(Precedence::PREFIX);
 
-        return prefix_expression.release();
+        return prefix_expression;
     };
 
     PrefixParseFn parse_boolean = [&]() -> Expression*
     {
-        return new Boolean(current_token, current_token.token_type == TokenType::_TRUE);
+        return arena->make<Boolean>(current_token, current_token.token_type == TokenType::_TRUE);
     };
 
     PrefixParseFn parse_null = [&]() -> Expression*
     {
-        return new Null(current_token);
+        return arena->make<Null>(current_token);
     };
 
     PrefixParseFn parse_grouped_expression = [&]() -> Expression*
     {
         advance_tokens();
-        auto expression = std::unique_ptr<Expression>(parse_expression(Precedence::LOWEST));
+        auto expression = parse_expression(Precedence::LOWEST);
 
         if (!expected_token(TokenType::RPAREN))
             return nullptr;
 
-        return expression.release();
+        return expression;
     };
 
     PrefixParseFn parse_if = [&]() -> Expression*
     {
-        auto if_expression = std::make_unique<If>(current_token);
+        auto if_expression = arena->make<If>(current_token);
 
         if(!expected_token(TokenType::LPAREN))
             return nullptr;
@@ -160,12 +203,32 @@ private:
             if_expression->alternative = parse_block();
         }
 
-        return if_expression.release();
+        return if_expression;
+    };
+
+    PrefixParseFn parse_while = [&]() -> Expression*
+    {
+        auto loop = arena->make<While>(current_token);
+
+        if(!expected_token(TokenType::LPAREN))
+            return nullptr;
+        advance_tokens();
+
+        loop->condition = parse_expression(Precedence::LOWEST);
+
+        if(!expected_token(TokenType::RPAREN))
+            return nullptr;
+
+        if(!expected_token(TokenType::LBRACE))
+            return nullptr;
+        loop->body = parse_block();
+
+        return loop;
     };
 
     PrefixParseFn parse_function = [&]() -> Expression*
     {
-        auto function = std::make_unique<Function>(current_token);
+        auto function = arena->make<Function>(current_token);
         if(!expected_token(TokenType::LPAREN))
             return nullptr;
         function->parameters = parse_function_parameters();
@@ -175,31 +238,88 @@ private:
 
         function->body = parse_block();
 
-        return function.release();
+        return function;
+    };
+
+    PrefixParseFn parse_array_literal = [&]() -> Expression*
+    {
+        auto array = arena->make<ArrayLiteral>(current_token);
+        array->elements = parse_expression_list(TokenType::RBRACKET);
+        return array;
+    };
+
+    PrefixParseFn parse_hash_literal = [&]() -> Expression*
+    {
+        auto hash = arena->make<HashLiteral>(current_token);
+        auto mark = pending.size();
+
+        while(peek_token.token_type != TokenType::RBRACE)
+        {
+            advance_tokens();
+            auto key = parse_expression(Precedence::LOWEST);
+            if(!expected_token(TokenType::COLON))
+            {
+                pending.resize(mark);
+                return nullptr;
+            }
+
+            advance_tokens();
+            auto value = parse_expression(Precedence::LOWEST);
+            if(!key || !value)
+            {
+                pending.resize(mark);
+                return nullptr;
+            }
+            pending.push_back(key);
+            pending.push_back(value);
+
+            if(peek_token.token_type != TokenType::RBRACE && !expected_token(TokenType::COMMA))
+            {
+                pending.resize(mark);
+                return nullptr;
+            }
+        }
+
+        hash->entries = take_pending<Expression>(mark);
+        if(!expected_token(TokenType::RBRACE))
+            return nullptr;
+
+        return hash;
     };
 
     PrefixParseFn parse_string_literal = [&]() -> Expression*
     {
-        auto string_literal = std::make_unique<StringLiteral>(current_token, current_token.literal);
-        return string_literal.release();
+        return arena->make<StringLiteral>(current_token, current_token.literal);
     };
 
     InfixParseFn parse_infix_expression = [&](Expression* left) -> Expression*
     {
-        auto infix = std::make_unique<Infix>(current_token, left, current_token.literal);
+        auto infix = arena->make<Infix>(current_token, left, current_token.literal, get_operator(current_token.token_type));
 
         auto precedence = get_precedence(current_token.token_type);
         advance_tokens();
         infix->right = parse_expression(precedence);
 
-        return infix.release();
+        return infix;
     };
 
     InfixParseFn parse_call = [&](Expression* function) -> Expression*
     {
-        auto call = std::make_unique<Call>(current_token, function);
-        call->arguments = parse_call_arguments();
-        return call.release();
+        auto call = arena->make<Call>(current_token, function);
+        call->arguments = parse_expression_list(TokenType::RPAREN);
+        return call;
+    };
+
+    InfixParseFn parse_index = [&](Expression* left) -> Expression*
+    {
+        auto index = arena->make<Index>(current_token, left);
+        advance_tokens();
+        index->index = parse_expression(Precedence::LOWEST);
+
+        if(!expected_token(TokenType::RBRACKET))
+            return nullptr;
+
+        return index;
     };
 
 };
@@ -0,0 +1,62 @@
+#include "profiler.h"
+#include "ast.h"
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <fmt/format.h>
+
+using namespace std;
+
+static constexpr string_view ROOT_FRAME = "programa";
+static constexpr string_view ANONYMOUS_FUNCTION = "procedimiento";
+
+Profiler::Profiler(chrono::microseconds interval)
+    : timer([this, interval] {
+        unique_lock lock(mutex);
+        while(!wake.wait_for(lock, interval, [this] { return stopping; }))
+            due.store(true, memory_order_relaxed);
+    })
+{}
+
+Profiler::~Profiler()
+{
+    {
+        lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    timer.join();
+}
+
+void Profiler::sample()
+{
+    due.store(false, memory_order_relaxed);
+    samples[stack]++;
+}
+
+size_t Profiler::sample_count() const
+{
+    size_t count = 0;
+    for(const auto& [stack, hits] : samples)
+        count += hits;
+    return count;
+}
+
+void Profiler::write(ostream& out) const
+{
+    for(const auto& [stack, hits] : samples)
+    {
+        string line(ROOT_FRAME);
+        for(auto function : stack)
+        {
+            if(!function || function->name.empty())
+                line += fmt::format(";{}:{}", ANONYMOUS_FUNCTION, function ? function->token.line : 0);
+            else
+                line += fmt::format(";{}:{}", function->name, function->token.line);
+        }
+        out << line << ' ' << hits << '\n';
+    }
+}
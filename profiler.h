@@ -0,0 +1,100 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+#include "ast.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+// Samples which lpp functions a program is in. The engines keep a shadow
+// stack of the definitions of the functions they are running with enter,
+// leave and tail_call; a timer thread raises a flag every interval, and the
+// next time the engine enters, leaves or loops the stack is counted once.
+// Samples therefore land on those points, which is close enough to find the
+// hot procedimiento without any signal handling.
+class Profiler
+{
+    std::vector<const ast::Function*> stack;
+    std::map<std::vector<const ast::Function*>, std::size_t> samples;
+    std::atomic<bool> due = false;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+    std::thread timer;
+
+    void sample();
+
+public:
+    static constexpr std::chrono::microseconds DEFAULT_INTERVAL{1000};
+
+    explicit Profiler(std::chrono::microseconds interval = DEFAULT_INTERVAL);
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+    ~Profiler();
+
+    void poll()
+    {
+        if(due.load(std::memory_order_relaxed)) [[unlikely]]
+            sample();
+    }
+
+    void enter(const ast::Function* function)
+    {
+        poll();
+        stack.push_back(function);
+    }
+
+    void leave()
+    {
+        poll();
+        stack.pop_back();
+    }
+
+    // the callee takes over the frame of the function returning its result
+    void tail_call(const ast::Function* function)
+    {
+        poll();
+        stack.back() = function;
+    }
+
+    std::size_t depth() const { return stack.size(); }
+    void unwind(const std::size_t depth)
+    {
+        poll();
+        stack.resize(depth);
+    }
+
+    std::size_t sample_count() const;
+    // One line per distinct stack, root first and separated by ';', followed
+    // by how many samples it got: the collapsed format flamegraph.pl reads.
+    void write(std::ostream&) const;
+};
+
+// The profiler of the interpreter running on this thread, nullptr unless it
+// was asked for one.
+inline thread_local Profiler* current_profiler = nullptr;
+
+// Leaves every frame entered while it is alive, for code that returns from
+// several places or gives up on a run in the middle of a call.
+class ProfileScope
+{
+    Profiler* const profiler;
+    const std::size_t depth;
+public:
+    explicit ProfileScope(Profiler* p) : profiler(p), depth(p ? p->depth() : 0) {}
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+    ~ProfileScope()
+    {
+        if(profiler)
+            profiler->unwind(depth);
+    }
+};
+
+#endif // PROFILER_H
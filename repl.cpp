@@ -1,18 +1,13 @@
-#include "ast.h"
-#include "lexer.h"
+#include "interpreter.h"
 #include "object.h"
-#include "parser.h"
-#include "token.h"
-#include "evaluator.h"
+#include "script.h"
 #include <iostream>
-#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 #include <fmt/core.h>
 
 using namespace std;
-using obj::Environment;
-using ast::Programs_Guard;
 
 void print_parser_errors(const vector<string>& errors)
 {
@@ -20,26 +15,24 @@ void print_parser_errors(const vector<string>& errors)
         cout << e;
 }
 
-void start_repl()
+void start_repl(const Options& options)
 {
-    auto env = make_unique<Environment>();
-    Programs_Guard guard;
+    Interpreter interpreter(options);
     for (string s = ""; s != "salir()"; getline(cin, s))
     {
-        Lexer lexer(s);
-        Parser parser(lexer);
-        auto program = guard.new_program(parser.parse_program());
-        if(parser.errors().size() > 0)
+        // the tree outlives this line, so the interpreter keeps the text
+        auto evaluated = interpreter.run(std::move(s));
+        if(!interpreter.errors().empty())
         {
-            print_parser_errors(parser.errors());
+            print_parser_errors(interpreter.errors());
             fmt::print("\n>> ");
             continue;
         }
 
-        auto evaluated = evaluate(program, env.get());
-
         if(evaluated != nullptr)
-            fmt::print("{}", evaluated->inspect());
+            fmt::print("{}", evaluated.inspect());
         fmt::print("\n>> ");
     }
+    write_stats(interpreter, options);
+    write_profile(interpreter, options);
 }
@@ -0,0 +1,239 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+#include "ast.h"
+#include "interner.h"
+#include "symbol_table.h"
+#include <memory>
+
+// Walks a program before it runs and gives every Identifier the scope depth
+// and slot it refers to, so neither engine compares names on the hot path.
+// Identifiers left unresolved are globals defined by a later program or
+// builtins, and are looked up by name.
+class Resolver : public ast::Visitor<Resolver, void>
+{
+private:
+    friend class ast::Visitor<Resolver, void>;
+    SymbolTable* symbols;
+    ast::Function* function = nullptr;
+
+    void declare(ast::ASTNode*);
+    void resolve_function(ast::Function*);
+
+    static Symbol intern(ast::Identifier* identifier)
+    {
+        if(!identifier->symbol)
+            identifier->symbol = interner().intern(identifier->value);
+        return identifier->symbol;
+    }
+
+    void resolve(ast::ASTNode* node)
+    {
+        if(node)
+            dispatch(node);
+    }
+
+    void visit(ast::Identifier* identifier)
+    {
+        identifier->resolved = symbols->resolve(intern(identifier), identifier->depth, identifier->slot);
+    }
+
+    void visit(ast::LetStatement* let_statement)
+    {
+        resolve(let_statement->name);
+        resolve(let_statement->value);
+    }
+
+    void visit(ast::AssignStatement* assign)
+    {
+        resolve(assign->name);
+        resolve(assign->value);
+    }
+
+    void visit(ast::ExpressionStatement* expression_statement) { resolve(expression_statement->expression); }
+    void visit(ast::ReturnStatement* return_statement) { resolve(return_statement->return_value); }
+
+    void visit(ast::Block* block)
+    {
+        for(auto s : block->statements)
+            resolve(s);
+    }
+
+    void visit(ast::If* if_expression)
+    {
+        resolve(if_expression->condition);
+        resolve(if_expression->consequence);
+        resolve(if_expression->alternative);
+    }
+
+    void visit(ast::While* loop)
+    {
+        resolve(loop->condition);
+        resolve(loop->body);
+    }
+
+    void visit(ast::Prefix* prefix) { resolve(prefix->right); }
+
+    void visit(ast::Infix* infix)
+    {
+        resolve(infix->left);
+        resolve(infix->right);
+    }
+
+    void visit(ast::Call* call)
+    {
+        resolve(call->function);
+        for(auto arg : call->arguments)
+            resolve(arg);
+    }
+
+    void visit(ast::ArrayLiteral* array)
+    {
+        for(auto element : array->elements)
+            resolve(element);
+    }
+
+    void visit(ast::HashLiteral* hash)
+    {
+        for(auto entry : hash->entries)
+            resolve(entry);
+    }
+
+    void visit(ast::Index* index)
+    {
+        resolve(index->left);
+        resolve(index->index);
+    }
+
+    void visit(ast::Function* fn) { resolve_function(fn); }
+
+    // literals and nested programs hold no identifiers
+    template<typename Node>
+    void visit(Node*) {}
+
+public:
+    explicit Resolver(SymbolTable& globals) : symbols(&globals) {}
+    void resolve(ast::Program*);
+};
+
+inline void Resolver::resolve(ast::Program* program)
+{
+    for(auto s : program->statements)
+        declare(s);
+    for(auto s : program->statements)
+        resolve(s);
+}
+
+// Collects the names a scope declares before any identifier in it is
+// resolved, so a closure can refer to a variable of its enclosing function
+// that is assigned after the closure itself is created.
+inline void Resolver::declare(ast::ASTNode* node)
+{
+    if(!node)
+        return;
+
+    switch (node->type()) {
+        case ast::Node::LetStatement:
+            {
+                auto let_statement = static_cast<ast::LetStatement*>(node);
+                symbols->define(intern(let_statement->name));
+                declare(let_statement->value);
+                break;
+            }
+        case ast::Node::AssignStatement:
+            {
+                auto assign = static_cast<ast::AssignStatement*>(node);
+                symbols->define(intern(assign->name));
+                declare(assign->value);
+                break;
+            }
+        case ast::Node::ExpressionStatement:
+            declare(static_cast<ast::ExpressionStatement*>(node)->expression);
+            break;
+        case ast::Node::ReturnStatement:
+            declare(static_cast<ast::ReturnStatement*>(node)->return_value);
+            break;
+        case ast::Node::Block:
+            for(auto s : static_cast<ast::Block*>(node)->statements)
+                declare(s);
+            break;
+        case ast::Node::If:
+            {
+                auto if_expression = static_cast<ast::If*>(node);
+                declare(if_expression->condition);
+                declare(if_expression->consequence);
+                declare(if_expression->alternative);
+                break;
+            }
+        case ast::Node::While:
+            {
+                auto loop = static_cast<ast::While*>(node);
+                declare(loop->condition);
+                declare(loop->body);
+                break;
+            }
+        case ast::Node::Prefix:
+            declare(static_cast<ast::Prefix*>(node)->right);
+            break;
+        case ast::Node::Infix:
+            {
+                auto infix = static_cast<ast::Infix*>(node);
+                declare(infix->left);
+                declare(infix->right);
+                break;
+            }
+        case ast::Node::Call:
+            {
+                auto call = static_cast<ast::Call*>(node);
+                declare(call->function);
+                for(auto arg : call->arguments)
+                    declare(arg);
+                break;
+            }
+        case ast::Node::ArrayLiteral:
+            for(auto element : static_cast<ast::ArrayLiteral*>(node)->elements)
+                declare(element);
+            break;
+        case ast::Node::HashLiteral:
+            for(auto entry : static_cast<ast::HashLiteral*>(node)->entries)
+                declare(entry);
+            break;
+        case ast::Node::Index:
+            {
+                auto index = static_cast<ast::Index*>(node);
+                declare(index->left);
+                declare(index->index);
+                break;
+            }
+        default:
+            // function literals open their own scope
+            break;
+    }
+}
+
+inline void Resolver::resolve_function(ast::Function* fn)
+{
+    if(function)
+        function->makes_closures = true;
+
+    // a tree is resolved once, the functions created from it keep its tables
+    if(fn->symbols)
+        return;
+
+    fn->symbols = std::make_unique<SymbolTable>(symbols);
+    for(auto p : fn->parameters)
+    {
+        fn->symbols->define(intern(p));
+        p->resolved = fn->symbols->resolve(p->symbol, p->depth, p->slot);
+    }
+
+    auto enclosing = symbols;
+    auto enclosing_function = function;
+    symbols = fn->symbols.get();
+    function = fn;
+    declare(fn->body);
+    resolve(fn->body);
+    symbols = enclosing;
+    function = enclosing_function;
+}
+
+#endif // RESOLVER_H
@@ -0,0 +1,149 @@
+#include "script.h"
+#include "gc.h"
+#include "interpreter.h"
+#include "object.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <fmt/format.h>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static constexpr string_view CANNOT_OPEN_FILE = "No se pudo abrir el archivo {}\n";
+static constexpr string_view CANNOT_WRITE_PROFILE = "No se pudo escribir el perfil en {}\n";
+static constexpr string_view STATS_ROW = "{:<12}{:>10}{:>14}{:>14}\n";
+static constexpr string_view STATS_FOOTER = "pico de memoria: {} bytes, recolecciones: {}\n";
+
+// A source file mapped read-only into memory, or read into a buffer where
+// mmap is not available.
+class SourceFile
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    string buffer;
+
+public:
+    explicit SourceFile(const char* path)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        auto fd = open(path, O_RDONLY);
+        if(fd < 0)
+            return;
+
+        struct stat info {};
+        if(fstat(fd, &info) == 0 && info.st_size > 0)
+        {
+            auto address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if(address != MAP_FAILED)
+            {
+                data = static_cast<const char*>(address);
+                size = static_cast<size_t>(info.st_size);
+                mapped = true;
+            }
+        }
+        close(fd);
+        if(mapped)
+            return;
+#endif
+        ifstream file(path, ios::binary);
+        if(!file)
+            return;
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        data = buffer.data();
+    }
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    ~SourceFile()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        if(mapped)
+            munmap(const_cast<char*>(data), size);
+#endif
+    }
+
+    explicit operator bool() const { return data != nullptr; }
+    string_view view() const { return mapped ? string_view(data, size) : string_view(buffer); }
+};
+
+int run_script(const char* path, const Options& options)
+{
+    SourceFile file(path);
+    if(!file)
+    {
+        fmt::print(stderr, CANNOT_OPEN_FILE, path);
+        return EXIT_FAILURE;
+    }
+
+    // declared after the file, so the mapping outlives the program's tokens
+    Interpreter interpreter(options);
+    auto result = interpreter.run_in_place(file.view());
+    if(!interpreter.errors().empty())
+    {
+        for(const auto& e : interpreter.errors())
+            fmt::print(stderr, "{}\n", e);
+        return EXIT_FAILURE;
+    }
+
+    write_stats(interpreter, options);
+    if(!write_profile(interpreter, options))
+        return EXIT_FAILURE;
+
+    if(result && result.type() == ObjectType::ERROR)
+    {
+        fmt::print(stderr, "{}\n", result.inspect());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+bool write_profile(const Interpreter& interpreter, const Options& options)
+{
+    auto profiler = interpreter.profiler();
+    if(!profiler)
+        return true;
+
+    ofstream file(options.profile);
+    if(file)
+        profiler->write(file);
+    if(!file)
+    {
+        fmt::print(stderr, CANNOT_WRITE_PROFILE, options.profile);
+        return false;
+    }
+    return true;
+}
+
+void write_stats(const Interpreter& interpreter, const Options& options)
+{
+    if(!options.stats)
+        return;
+
+    const auto& heap = interpreter.memory();
+    gc::KindStats total;
+    fmt::print(stderr, STATS_ROW, "tipo", "vivos", "asignaciones", "bytes");
+    for(size_t kind = 0; kind < gc::Collectable::KINDS; kind++)
+    {
+        const auto& stats = heap.stats(kind);
+        if(stats.allocations == 0)
+            continue;
+        fmt::print(stderr, STATS_ROW, obj::kind_name(kind), stats.live, stats.allocations, stats.bytes);
+        total.live += stats.live;
+        total.allocations += stats.allocations;
+        total.bytes += stats.bytes;
+    }
+    fmt::print(stderr, STATS_ROW, "total", total.live, total.allocations, total.bytes);
+    fmt::print(stderr, STATS_FOOTER, heap.peak_bytes(), heap.collections());
+}
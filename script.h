@@ -0,0 +1,18 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+#include "interpreter.h"
+
+// Runs a whole source file once, without the REPL banner or prompt, and
+// returns the process exit status: EXIT_FAILURE when the file cannot be read,
+// does not parse, or evaluates to an error.
+int run_script(const char* path, const Options& options);
+
+// Writes the samples of an interpreter to options.profile, when it was asked
+// for one, and returns false when the file cannot be written.
+bool write_profile(const Interpreter& interpreter, const Options& options);
+
+// Prints to stderr what the heap of an interpreter made, by kind of object,
+// when options.stats asks for it.
+void write_stats(const Interpreter& interpreter, const Options& options);
+
+#endif // SCRIPT_H
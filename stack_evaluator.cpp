@@ -0,0 +1,478 @@
+#include "stack_evaluator.h"
+#include "ast.h"
+#include "builtin.h"
+#include "evaluator.h"
+#include "gc.h"
+#include "object.h"
+#include "profiler.h"
+#include "resolver.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+
+using namespace std;
+using ast::Call;
+
+static constexpr string_view MAX_DEPTH_EXCEEDED = "Se excedió la profundidad máxima de {} llamadas cerca de la línea {}";
+
+// step of a Call whose callee body is running
+static constexpr uint32_t IN_BODY = numeric_limits<uint32_t>::max();
+
+StackEvaluator::StackEvaluator(const size_t max_depth) : max_depth(max_depth) {}
+
+Value StackEvaluator::run(Program* program, Environment* env)
+{
+    gc::RootScope roots(gc::heap(), this);
+    profiler = current_profiler;
+    ProfileScope profile(profiler);
+    Resolver(*env->symbols).resolve(program);
+    env->grow();
+    frames.push_back({env, 0});
+
+    Value result = nullptr;
+    for(auto s : program->statements)
+    {
+        result = execute(s);
+        if(std::exchange(returning, false) || is_error(result))
+            break;
+    }
+
+    frames.pop_back();
+    return result;
+}
+
+Environment* StackEvaluator::make_environment(obj::Function* function)
+{
+    if(needs_heap_environment(function->definition))
+        return gc::heap().make<Environment>(function->env, function->symbols);
+    return pool.acquire(function->env, function->symbols);
+}
+
+void StackEvaluator::trace(gc::Heap& heap)
+{
+    for(auto value : values)
+        heap.mark(value.object());
+    for(auto& frame : frames)
+        heap.mark(frame.env);
+}
+
+// Leaves are evaluated on the spot and return true, any other node is left
+// on tasks to wait for its children.
+bool StackEvaluator::schedule(ASTNode* node, Environment* env)
+{
+    switch(auto kind = node->type())
+    {
+        case Node::Integer:
+            values.push_back(Value::integer(static_cast<int64_t>(static_cast<ast::Integer*>(node)->value)));
+            return true;
+        case Node::Boolean:
+            values.push_back(to_boolean_object(static_cast<ast::Boolean*>(node)->value));
+            return true;
+        case Node::Null:
+            values.push_back(_NULL);
+            return true;
+        case Node::Identifier:
+            values.push_back(evaluate_identifier(static_cast<Identifier*>(node), env));
+            return true;
+        case Node::StringLiteral:
+        {
+            auto string_literal = static_cast<ast::StringLiteral*>(node);
+            if(string_literal->object)
+                values.push_back(string_literal->object);
+            else
+                values.push_back(gc::heap().make<obj::String>(string(string_literal->value)));
+            return true;
+        }
+        case Node::Function:
+        {
+            auto function = static_cast<ast::Function*>(node);
+            env->captured = true;
+            values.push_back(gc::heap().make<obj::Function>(function->parameters, function->body, env, function->symbols.get(), function));
+            return true;
+        }
+        case Node::Expression:
+        case Node::Statement:
+            // only base classes
+            values.push_back(nullptr);
+            return true;
+        case Node::ExpressionStatement:
+            return schedule(static_cast<ExpressionStatement*>(node)->expression, env);
+        default:
+            tasks.push_back({node, kind, 0, 0, false});
+            return false;
+    }
+}
+
+Value StackEvaluator::execute(ASTNode* node)
+{
+    const auto entry_tasks = tasks.size();
+    const auto entry_values = values.size();
+    const auto entry_frames = frames.size();
+    auto env = frames.back().env;
+
+    schedule(node, env);
+    while(tasks.size() > entry_tasks)
+    {
+        // A task goes on with its next step right away when the child it
+        // scheduled was a leaf. Otherwise tasks may have been reallocated, so
+        // task is not touched again until the child is done.
+        auto& task = tasks.back();
+        switch(task.kind)
+        {
+            case Node::Prefix:
+            {
+                auto prefix = static_cast<Prefix*>(task.node);
+                if(task.step++ == 0 && !schedule(prefix->right, env))
+                    break;
+                assert(values.back());
+                values.back() = evaluate_prefix_expression(prefix->op, values.back(), prefix->token.line);
+                tasks.pop_back();
+                break;
+            }
+            case Node::Infix:
+            {
+                auto infix = static_cast<Infix*>(task.node);
+                if(task.step == 0)
+                {
+                    task.step++;
+                    if(!schedule(infix->left, env))
+                        break;
+                }
+                if(task.step == 1)
+                {
+                    task.step++;
+                    if(!schedule(infix->right, env))
+                        break;
+                }
+                // both operands stay on values, and so rooted, until the result is made
+                auto right = values.back();
+                auto left = values[values.size() - 2];
+                assert(left && right);
+                auto result = evaluate_infix_expression(infix->op, left, right, infix->token.line);
+                values.pop_back();
+                values.back() = result;
+                tasks.pop_back();
+                break;
+            }
+            case Node::Index:
+            {
+                auto index = static_cast<ast::Index*>(task.node);
+                if(task.step == 0)
+                {
+                    task.step++;
+                    if(!schedule(index->left, env))
+                        break;
+                }
+                if(task.step == 1)
+                {
+                    task.step++;
+                    if(!schedule(index->index, env))
+                        break;
+                }
+                auto position = values.back();
+                auto left = values[values.size() - 2];
+                assert(left && position);
+                auto result = evaluate_index_expression(left, position, index->token.line);
+                values.pop_back();
+                values.back() = result;
+                tasks.pop_back();
+                break;
+            }
+            case Node::ArrayLiteral:
+            {
+                auto array = static_cast<ast::ArrayLiteral*>(task.node);
+                if(task.step == 0)
+                    task.base = static_cast<uint32_t>(values.size());
+                bool ready = true;
+                while(ready && task.step < array->elements.size())
+                {
+                    // elements evaluating to nothing are left out, as in evaluate()
+                    if(values.size() > task.base && !values.back())
+                        values.pop_back();
+                    ready = schedule(array->elements[task.step++], env);
+                }
+                if(!ready)
+                    break;
+                if(values.size() > task.base && !values.back())
+                    values.pop_back();
+
+                // the elements stay on values, and so rooted, until the array holds them
+                const auto first = values.begin() + static_cast<ptrdiff_t>(task.base);
+                auto result = make_array(vector<Value>(first, values.end()));
+                values.resize(task.base);
+                values.push_back(result);
+                tasks.pop_back();
+                break;
+            }
+            case Node::HashLiteral:
+            {
+                auto hash = static_cast<ast::HashLiteral*>(task.node);
+                if(task.step == 0)
+                    task.base = static_cast<uint32_t>(values.size());
+                bool ready = true;
+                while(ready && task.step < hash->entries.size())
+                {
+                    // a key or a value evaluating to nothing counts as nulo, as in evaluate()
+                    if(task.step > 0 && !values.back())
+                        values.back() = _NULL;
+                    ready = schedule(hash->entries[task.step++], env);
+                }
+                if(!ready)
+                    break;
+                if(task.step > 0 && !values.back())
+                    values.back() = _NULL;
+
+                // the entries stay on values, and so rooted, until the table holds them
+                auto result = make_hash(span<const Value>(values.data() + task.base, values.size() - task.base), hash->token.line);
+                values.resize(task.base);
+                values.push_back(result);
+                tasks.pop_back();
+                break;
+            }
+            case Node::Block:
+            {
+                auto block = static_cast<Block*>(task.node);
+                for(;;)
+                {
+                    if(task.step > 0)
+                    {
+                        auto result = values.back();
+                        if(returning || is_error(result) || task.step == block->statements.size())
+                        {
+                            tasks.pop_back();
+                            break;
+                        }
+                        values.pop_back();
+                    }
+                    else if(block->statements.empty())
+                    {
+                        values.push_back(nullptr);
+                        tasks.pop_back();
+                        break;
+                    }
+                    if(!schedule(block->statements[task.step++], env))
+                        break;
+                }
+                break;
+            }
+            case Node::If:
+            {
+                auto if_expression = static_cast<If*>(task.node);
+                if(task.step++ == 0 && !schedule(if_expression->condition, env))
+                    break;
+                auto condition = values.back();
+                assert(condition);
+                values.pop_back();
+                tasks.pop_back();
+                // the branch takes the place of the if
+                if(is_truthy(condition))
+                    schedule(if_expression->consequence, env);
+                else if(if_expression->alternative)
+                    schedule(if_expression->alternative, env);
+                else
+                    values.push_back(_NULL);
+                break;
+            }
+            case Node::While:
+            {
+                // step 1 waits on the condition and step 2 on the body
+                auto loop = static_cast<ast::While*>(task.node);
+                for(;;)
+                {
+                    if(task.step == 2)
+                    {
+                        if(profiler) [[unlikely]]
+                            profiler->poll();
+                        auto result = values.back();
+                        if(returning || is_error(result))
+                        {
+                            tasks.pop_back();
+                            break;
+                        }
+                        values.pop_back();
+                        task.step = 0;
+                    }
+                    if(task.step == 0)
+                    {
+                        task.step = 1;
+                        if(!schedule(loop->condition, env))
+                            break;
+                    }
+                    auto condition = values.back();
+                    assert(condition);
+                    if(is_error(condition))
+                    {
+                        tasks.pop_back();
+                        break;
+                    }
+                    values.pop_back();
+                    if(!is_truthy(condition))
+                    {
+                        values.push_back(_NULL);
+                        tasks.pop_back();
+                        break;
+                    }
+                    task.step = 2;
+                    if(!schedule(loop->body, env))
+                        break;
+                }
+                break;
+            }
+            case Node::ReturnStatement:
+            {
+                auto return_statement = static_cast<ReturnStatement*>(task.node);
+                if(task.step == 0 && return_statement->return_value->type() == Node::Call && frames.size() > 1)
+                {
+                    task.step++;
+                    tasks.push_back({return_statement->return_value, Node::Call, 0, 0, true});
+                    break;
+                }
+                if(task.step++ == 0 && !schedule(return_statement->return_value, env))
+                    break;
+                assert(values.back());
+                returning = true;
+                tasks.pop_back();
+                break;
+            }
+            case Node::LetStatement:
+            {
+                auto let_statement = static_cast<LetStatement*>(task.node);
+                if(task.step++ == 0 && !schedule(let_statement->value, env))
+                    break;
+                env->slots[let_statement->name->slot] = values.back();
+                tasks.pop_back();
+                break;
+            }
+            case Node::AssignStatement:
+            {
+                auto assign = static_cast<AssignStatement*>(task.node);
+                if(task.step++ == 0 && !schedule(assign->value, env))
+                    break;
+                env->slots[assign->name->slot] = values.back();
+                tasks.pop_back();
+                break;
+            }
+            case Node::Call:
+            {
+                auto call = static_cast<Call*>(task.node);
+                if(task.step == IN_BODY)
+                {
+                    returning = false;
+                    pool.release(frames.back().env);
+                    frames.pop_back();
+                    env = frames.back().env;
+                    tasks.pop_back();
+                    if(profiler) [[unlikely]]
+                        profiler->leave();
+                    break;
+                }
+                if(task.step == 0)
+                {
+                    task.base = static_cast<uint32_t>(values.size());
+                    task.step++;
+                    if(!schedule(call->function, env))
+                        break;
+                }
+                bool ready = true;
+                while(ready && task.step <= call->arguments.size())
+                {
+                    // arguments evaluating to nothing are left out, as in evaluate()
+                    if(task.step > 1 && !values.back())
+                        values.pop_back();
+                    ready = schedule(call->arguments[task.step++ - 1], env);
+                }
+                if(!ready)
+                    break;
+                if(task.step > 1 && !values.back())
+                    values.pop_back();
+
+                const size_t base = task.base;
+                const auto line = call->token.line;
+                auto callee = values[base];
+                auto argc = values.size() - base - 1;
+                if(callee.type() == ObjectType::FUNCTION)
+                {
+                    auto function = callee.as<obj::Function>();
+                    if(function->parameters.size() != argc)
+                    {
+                        auto error = gc::heap().make<Error>(fmt::format(WRONG_ARGS, line, function->parameters.size(), argc));
+                        values.resize(base);
+                        values.push_back(error);
+                        tasks.pop_back();
+                        break;
+                    }
+                    if(task.tail_call)
+                    {
+                        // the function being left is done with its values and tasks
+                        auto& frame = frames.back();
+                        if(frame.env->reusable_for(function->symbols))
+                            frame.env->reuse(function->env);
+                        else
+                        {
+                            pool.release(frame.env);
+                            frame.env = make_environment(function);
+                        }
+                        for(size_t i = 0; i < argc; i++)
+                            frame.env->slots[function->parameters[i]->slot] = values[base + 1 + i];
+                        env = frame.env;
+                        values.resize(tasks[frame.task].base);
+                        tasks.resize(frame.task + 1);
+                        returning = false;
+                        if(profiler) [[unlikely]]
+                            profiler->tail_call(function->definition);
+                        schedule(function->body, env);
+                        break;
+                    }
+                    if(frames.size() > max_depth)
+                    {
+                        auto error = gc::heap().make<Error>(fmt::format(MAX_DEPTH_EXCEEDED, max_depth, line));
+                        tasks.resize(entry_tasks);
+                        values.resize(entry_values);
+                        for(auto i = entry_frames; i < frames.size(); i++)
+                            pool.release(frames[i].env);
+                        frames.resize(entry_frames);
+                        return error;
+                    }
+
+                    // the callee and its arguments are still rooted on values
+                    auto extended_environment = make_environment(function);
+                    for(size_t i = 0; i < argc; i++)
+                        extended_environment->slots[function->parameters[i]->slot] = values[base + 1 + i];
+                    values.resize(base);
+                    frames.push_back({extended_environment, tasks.size() - 1});
+                    env = extended_environment;
+                    task.step = IN_BODY;
+                    // a regresa evaluated among the arguments does not leave the callee
+                    returning = false;
+                    if(profiler) [[unlikely]]
+                        profiler->enter(function->definition);
+                    schedule(function->body, env);
+                    break;
+                }
+
+                Value result = nullptr;
+                if(callee.type() == ObjectType::BUILTIN)
+                    result = callee.as<obj::Builtin>()->fn(span<const Value>(values).subspan(base + 1), line);
+                else
+                    result = gc::heap().make<Error>(fmt::format(NOT_A_FUNCTION, callee.type_string(), line));
+                values.resize(base);
+                values.push_back(result);
+                tasks.pop_back();
+                break;
+            }
+            default:
+                assert(false && "leaves are never scheduled as tasks");
+                tasks.pop_back();
+        }
+    }
+
+    auto result = values.back();
+    values.pop_back();
+    return result;
+}
@@ -0,0 +1,64 @@
+#ifndef STACK_EVALUATOR_H
+#define STACK_EVALUATOR_H
+#include "ast.h"
+#include "gc.h"
+#include "object.h"
+#include "profiler.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Tree walking evaluator that keeps the nodes it is in the middle of, and the
+// environments of the lpp calls, on growable heap stacks instead of the C++
+// call stack. It gives the same results as evaluate(), but recursion in a
+// script is bounded by max_depth instead of the native stack: a call nested
+// deeper than that ends the run with an Error.
+class StackEvaluator : public gc::Collectable
+{
+public:
+    static constexpr std::size_t DEFAULT_MAX_DEPTH = 100000;
+
+private:
+    // A node waiting for the results of its children, which are pushed on
+    // values. step says how many of them were scheduled so far and base is
+    // where the callee of a Call sits in values. A tail call replaces the
+    // body of the call it is returned from instead of nesting in it.
+    struct Task
+    {
+        ast::ASTNode* node;
+        ast::Node kind;
+        std::uint32_t step;
+        std::uint32_t base;
+        bool tail_call;
+    };
+
+    // The environment of an lpp call and the Call task running its body.
+    struct Frame
+    {
+        obj::Environment* env;
+        std::size_t task;
+    };
+
+    std::vector<Task> tasks;
+    std::vector<obj::Value> values;
+    std::vector<Frame> frames;
+    const std::size_t max_depth;
+    Profiler* profiler = nullptr;
+    // set by regresa on top of the value it leaves on values, until the
+    // call or program it returns from takes it
+    bool returning = false;
+    obj::EnvironmentPool pool;
+
+    obj::Value execute(ast::ASTNode*);
+    obj::Environment* make_environment(obj::Function*);
+    bool schedule(ast::ASTNode*, obj::Environment*);
+
+public:
+    explicit StackEvaluator(const std::size_t max_depth = DEFAULT_MAX_DEPTH);
+    StackEvaluator(const StackEvaluator&) = delete;
+    StackEvaluator& operator=(const StackEvaluator&) = delete;
+    obj::Value run(ast::Program*, obj::Environment*);
+    void trace(gc::Heap&) override;
+};
+
+#endif // STACK_EVALUATOR_H
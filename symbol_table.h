@@ -0,0 +1,53 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+#include "interner.h"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Names declared in one scope (the global one or a function body) mapped to
+// the slot they occupy in the runtime frame of that scope. Names are the
+// Symbols of the interpreter's Interner, so looking one up hashes a pointer.
+class SymbolTable
+{
+    std::unordered_map<Symbol, std::size_t> store;
+    std::vector<Symbol> names;
+
+public:
+    SymbolTable* const outer;
+
+    explicit SymbolTable(SymbolTable* outer = nullptr) : outer(outer) {}
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    std::size_t define(const Symbol name)
+    {
+        auto [it, added] = store.try_emplace(name, names.size());
+        if(added)
+            names.push_back(name);
+        return it->second;
+    }
+
+    bool find(const Symbol name, std::size_t& slot) const
+    {
+        auto it = store.find(name);
+        if(it == store.end())
+            return false;
+        slot = it->second;
+        return true;
+    }
+
+    bool resolve(const Symbol name, std::size_t& depth, std::size_t& slot) const
+    {
+        depth = 0;
+        for(auto table = this; table; table = table->outer, depth++)
+            if(table->find(name, slot))
+                return true;
+        return false;
+    }
+
+    Symbol name(const std::size_t slot) const { return names.at(slot); }
+    std::size_t size() const { return names.size(); }
+};
+
+#endif // SYMBOL_TABLE_H
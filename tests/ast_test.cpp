@@ -11,14 +11,15 @@ TEST_CASE("Let statement", "[ast]")
     string let = "variable";
     string var1 = "mi_var";
     string var2 = "otra_var";
+    Arena arena;
     Program program(vector<Statement*>{
-                        new LetStatement(
+                        arena.make<LetStatement>(
                             Token(TokenType::LET, let),
-                            new Identifier(
+                            arena.make<Identifier>(
                                 Token(TokenType::IDENT, var1),
                                 var1
                             ),
-                            new Identifier(
+                            arena.make<Identifier>(
                                 Token(TokenType::IDENT, var2),
                                 var2
                             )
@@ -34,10 +35,11 @@ TEST_CASE("Return statement", "[ast]")
 {
     string return_value = "regresa";
     string expression = "100";
+    Arena arena;
     Program program(vector<Statement*>{
-                        new ReturnStatement(
+                        arena.make<ReturnStatement>(
                             Token(TokenType::RETURN, return_value),
-                            new Expression(
+                            arena.make<Expression>(
                                 Token(TokenType::INT, expression)
                             )
                         )
@@ -50,21 +52,22 @@ TEST_CASE("Return statement", "[ast]")
 
 TEST_CASE("Expression statement", "[ast]")
 {
+    Arena arena;
     Program program(vector<Statement*>{
-                        new ExpressionStatement{
+                        arena.make<ExpressionStatement>(
                             Token(TokenType::IDENT, "foo", 1, 3),
-                            new Identifier(
+                            arena.make<Identifier>(
                                 Token(TokenType::IDENT, "foo", 1, 3),
                                 "foo"
                             )
-                        },
-                        new ExpressionStatement{
+                        ),
+                        arena.make<ExpressionStatement>(
                             Token(TokenType::INT, "5"),
-                            new Identifier(
+                            arena.make<Identifier>(
                                 Token(TokenType::INT, "5"),
                                 "5"
                             )
-                        }
+                        )
     });
 
     string program_str = program.to_string();
@@ -76,11 +79,12 @@ TEST_CASE("Assign statement", "[ast]")
 {
     string var = "a";
     string value = "mi_var";
+    Arena arena;
     Program program(vector<Statement*>{
-                        new AssignStatement(
+                        arena.make<AssignStatement>(
                             Token(TokenType::ASSIGN, "="),
-                            new Identifier(Token(TokenType::IDENT, "a"), "a"),
-                            new Expression(Token(TokenType::STRING, "mi_var", 1, 6))
+                            arena.make<Identifier>(Token(TokenType::IDENT, "a"), "a"),
+                            arena.make<Expression>(Token(TokenType::STRING, "mi_var", 1, 6))
         )
     });
 
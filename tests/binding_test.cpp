@@ -0,0 +1,67 @@
+#include "../binding.h"
+#include "../interpreter.h"
+#include "../object.h"
+#include "catch2/catch.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+using namespace std;
+using obj::Value;
+
+static constexpr Engine engines[] = {Engine::TREE_WALKER, Engine::STACK, Engine::VM};
+
+static int64_t contar(string_view text, int64_t times) { return static_cast<int64_t>(text.size()) * times; }
+static string repetir(string_view text, int32_t times)
+{
+    string result;
+    for(int32_t i = 0; i < times; i++)
+        result += text;
+    return result;
+}
+static bool par(int64_t n) noexcept { return n % 2 == 0; }
+static Value mismo(Value value) { return value; }
+static int64_t llamadas = 0;
+static void contar_llamada() { llamadas++; }
+
+static Value run(Interpreter& interpreter, const string& source)
+{
+    auto result = interpreter.run(source);
+    REQUIRE(interpreter.errors().empty());
+    return result;
+}
+
+TEST_CASE("Bound functions convert their arguments and result", "[binding]")
+{
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine});
+        interpreter.define<contar>("contar");
+        interpreter.define<repetir>("repetir");
+        interpreter.define<par>("par");
+        interpreter.define<mismo>("mismo");
+        interpreter.define<contar_llamada>("contar_llamada");
+
+        REQUIRE(run(interpreter, "contar(\"abc\", 4);").as_integer() == 12);
+        REQUIRE(run(interpreter, "repetir(\"ab\", 3);").inspect() == "ababab");
+        REQUIRE(run(interpreter, "par(10);") == Value::boolean(true));
+        REQUIRE(run(interpreter, "mismo([1, 2]);").inspect() == "[1, 2]");
+
+        llamadas = 0;
+        REQUIRE(run(interpreter, "contar_llamada();").is_null());
+        REQUIRE(llamadas == 1);
+    }
+}
+
+TEST_CASE("Bound functions check arity and types", "[binding]")
+{
+    Interpreter interpreter;
+    interpreter.define<contar>("contar");
+
+    auto wrong_count = run(interpreter, "contar(\"abc\");");
+    REQUIRE(wrong_count.type() == obj::ObjectType::ERROR);
+    REQUIRE(wrong_count.inspect().find("contar") != string::npos);
+
+    auto wrong_type = run(interpreter, "contar(\"abc\", \"d\");");
+    REQUIRE(wrong_type.type() == obj::ObjectType::ERROR);
+    REQUIRE(wrong_type.inspect().find("STRING") != string::npos);
+}
@@ -12,13 +12,14 @@ using namespace std;
 using obj::Object;
 using ast::Program;
 using obj::String;
+using obj::Value;
 
-Object* evaluate_tests(const string& str, Environment* env = nullptr)
+Value evaluate_tests(const string& str, Environment* env = nullptr)
 {
     Lexer lexer(str);
     Parser parser(lexer);
     Program program(parser.parse_program());
-    Object* evaluated = nullptr;
+    Value evaluated = nullptr;
     if(!env)
     {
         auto temp_env = make_unique<Environment>();
@@ -32,27 +33,27 @@ Object* evaluate_tests(const string& str, Environment* env = nullptr)
     return evaluated;
 }
 
-void test_object(Object* evaluated, const int expected)
+void test_object(Value evaluated, const int expected)
 {
-    auto eval = static_cast<obj::Integer*>(evaluated);
-    REQUIRE(eval->value == expected);
+    REQUIRE(evaluated.is_integer());
+    REQUIRE(evaluated.as_integer() == expected);
 }
 
-void test_object(Object* evaluated, const bool expected)
+void test_object(Value evaluated, const bool expected)
 {
-    auto eval = static_cast<obj::Boolean*>(evaluated);
-    REQUIRE(eval->value == expected);
+    REQUIRE(evaluated.is_boolean());
+    REQUIRE(evaluated.as_boolean() == expected);
 }
 
-void test_object(Object* evaluated, const char* expected)
+void test_object(Value evaluated, const char* expected)
 {
-    auto eval = static_cast<obj::Error*>(evaluated);
+    auto eval = evaluated.as<obj::Error>();
     REQUIRE(eval->message == expected);
 }
 
-void test_object(Object* evaluated)
+void test_object(Value evaluated)
 {
-    REQUIRE(evaluated == _NULL.get());
+    REQUIRE(evaluated == _NULL);
 }
 
 template<typename T>
@@ -242,7 +243,24 @@ TEST_CASE("Error handling")
         {"longitud(1);",
             "Argumento para longitud sin soporte, se recibió INTEGER cerca de la línea 1"},
         {"longitud(\"uno\", \"dos\");",
-            "Número incorrecto de argumentos para longitud, se recibieron 2, se esperaba 1, cerca de la línea 1"}
+            "Número incorrecto de argumentos para longitud, se recibieron 2, se esperaba 1, cerca de la línea 1"},
+        {"[1, 2][verdadero]", "Operador de índice no soportado: ARRAY[BOOLEAN] cerca de la línea 1"},
+        {"5[0]", "Operador de índice no soportado: INTEGER[INTEGER] cerca de la línea 1"},
+        {"[1, 2 + verdadero, 3]", "Discrepancia de tipos: INTEGER + BOOLEAN cerca de la línea 1"},
+        {"agregar(1, 2);", "Argumento para agregar sin soporte, se recibió INTEGER cerca de la línea 1"},
+        {"agregar([]);",
+            "Número incorrecto de argumentos para agregar, se recibieron 1, se esperaba 2, cerca de la línea 1"},
+        {"rebanar([1], \"a\");", "Argumento para rebanar sin soporte, se recibió STRING cerca de la línea 1"},
+        {"rebanar([1]);",
+            "Número incorrecto de argumentos para rebanar, se recibieron 1, se esperaba 2 o 3, cerca de la línea 1"},
+        {"concatenar([1], 2);", "Argumento para concatenar sin soporte, se recibió INTEGER cerca de la línea 1"},
+        {"{[1]: 2}", "No se puede usar como clave de un diccionario: ARRAY cerca de la línea 1"},
+        {"{1: 2}[procedimiento(x) { x }]", "No se puede usar como clave de un diccionario: FUNCTION cerca de la línea 1"},
+        {"{1: 2 + verdadero}", "Discrepancia de tipos: INTEGER + BOOLEAN cerca de la línea 1"},
+        {"obtener([], 1);", "Argumento para obtener sin soporte, se recibió ARRAY cerca de la línea 1"},
+        {"poner({}, 1);",
+            "Número incorrecto de argumentos para poner, se recibieron 2, se esperaba 3, cerca de la línea 1"},
+        {"contiene({}, nulo);", "No se puede usar como clave de un diccionario: NULL cerca de la línea 1"}
         };
 
     eval_and_test_objects(tests);
@@ -283,7 +301,7 @@ TEST_CASE("Function evaluation")
     Program program(parser.parse_program());
 
     auto env = new Environment();
-    auto evaluated = static_cast<obj::Function*>(evaluate(&program, env));
+    auto evaluated = evaluate(&program, env).as<obj::Function>();
 
     REQUIRE(evaluated != nullptr);
 
@@ -332,6 +350,93 @@ TEST_CASE("Function calls")
     }
 }
 
+TEST_CASE("Closures and scopes")
+{
+    vector<tuple<string,int>> tests {
+        {"variable sumador = procedimiento(x) {                 \
+                regresa procedimiento(y) { regresa x + y; };    \
+            };                                                  \
+            variable suma_dos = sumador(2);                     \
+            suma_dos(3);", 5},
+        {"variable x = 10;                                      \
+            variable f = procedimiento(x) { regresa x * 2; };   \
+            f(3) + x;", 16},
+        {"variable f = procedimiento() {                        \
+                variable g = procedimiento() { regresa y; };    \
+                variable y = 7;                                 \
+                regresa g();                                    \
+            };                                                  \
+            f();", 7},
+        {"variable a = 1;                                       \
+            variable f = procedimiento() { regresa a; };        \
+            a = 5;                                              \
+            f();", 5}
+    };
+
+    auto env = new Environment();
+    for(auto& t : tests)
+    {
+        auto evaluated = evaluate_tests(get<0>(t), env);
+        test_object(evaluated, get<1>(t));
+    }
+}
+
+TEST_CASE("Tail calls")
+{
+    // far deeper than the native stack allows if every call nested
+    auto evaluated = evaluate_tests(
+        "variable contar = procedimiento(n, acc) {              \
+            si (n == 0) { regresa acc; }                        \
+            regresa contar(n - 1, acc + n);                     \
+        };                                                      \
+        contar(200000, 0);");
+    REQUIRE(evaluated.as_integer() == 20000100000);
+
+    evaluated = evaluate_tests(
+        "variable par = procedimiento(n) { si (n == 0) { regresa verdadero; } regresa impar(n - 1); }; \
+        variable impar = procedimiento(n) { si (n == 0) { regresa falso; } regresa par(n - 1); };      \
+        par(200001);");
+    test_object(evaluated, false);
+
+    vector<tuple<string,int>> tests {
+        // the closure keeps the environment the tail call would otherwise reuse
+        {"variable f = procedimiento(n, g) {                    \
+                si (n == 0) { regresa g(); }                    \
+                regresa f(n - 1, procedimiento() { n });        \
+            };                                                  \
+            f(3, procedimiento() { 0 });", 1},
+        {"variable f = procedimiento(s) { regresa longitud(s); 5 }; f(\"abc\");", 3}
+    };
+    for(auto& t : tests)
+        test_object(evaluate_tests(get<0>(t)), get<1>(t));
+
+    evaluated = evaluate_tests("variable f = procedimiento(x) { regresa f(); }; f(1);");
+    test_object(evaluated, "Cantidad errónea de argumentos para la función cerca de la línea 1, se esperaban 1 pero se obtuvo 0");
+}
+
+TEST_CASE("While evaluation")
+{
+    vector<tuple<string,int>> tests {
+        {"variable i = 0; variable suma = 0; mientras (i < 100) { i = i + 1; suma = suma + i; }; suma;", 5050},
+        {"variable i = 0; mientras (i < 10) { i = i + 1; si (i == 5) { regresa i * 10; } }; 0;", 50},
+        {"variable f = procedimiento(n) { variable i = 0; mientras (verdadero) { si (i == n) { regresa i; } i = i + 1; } };"
+            "f(7);", 7},
+        {"variable i = 10; mientras (i > 0) { i = i - 1; }; i;", 0}
+    };
+    for(auto& t : tests)
+    {
+        INFO(get<0>(t));
+        test_object(evaluate_tests(get<0>(t)), get<1>(t));
+    }
+
+    test_object(evaluate_tests("mientras (falso) { 1 }"));
+    test_object(evaluate_tests("variable i = 0; mientras (i < 3) { i = i + 1; }"));
+    test_object(evaluate_tests("mientras (1 + verdadero) { 1 }; 5;"),
+        "Discrepancia de tipos: INTEGER + BOOLEAN cerca de la línea 1");
+    test_object(evaluate_tests("variable i = 0; mientras (i < 3) { i = i + 1; -verdadero; }; 5;"),
+        "Operador desconocido: -BOOLEAN cerca de la línea 1");
+}
+
 TEST_CASE("String evaluation")
 {
     vector<tuple<string,string>> tests {
@@ -350,8 +455,8 @@ TEST_CASE("String evaluation")
 
     for(auto& t : tests)
     {
-        auto evaluated = static_cast<String*>(evaluate_tests(get<0>(t)));
-        REQUIRE(evaluated->value == get<1>(t));
+        auto evaluated = evaluate_tests(get<0>(t)).as<String>();
+        REQUIRE(evaluated->value() == get<1>(t));
     }
 }
 
@@ -386,8 +491,8 @@ TEST_CASE("String concatenation")
 
     for(auto& t : tests)
     {
-        auto evaluated = static_cast<String*>(evaluate_tests(get<0>(t)));
-        REQUIRE(evaluated->value == get<1>(t));
+        auto evaluated = evaluate_tests(get<0>(t)).as<String>();
+        REQUIRE(evaluated->value() == get<1>(t));
     }
 }
 
@@ -408,8 +513,107 @@ TEST_CASE("Builtin functions")
     vector<tuple<string,int>> tests {
         {"longitud(\"\");", 0},
         {"longitud(\"cuatro\");", 6},
-        {"longitud(\"Hola mundo\");", 10}
+        {"longitud(\"Hola mundo\");", 10},
+        {"longitud([]);", 0},
+        {"longitud([1, 2, 3]);", 3},
+        {"variable a = [1]; agregar(a, 2); agregar(a, 3); longitud(a);", 3},
+        {"longitud(rebanar([1, 2, 3, 4], 1, 3));", 2},
+        {"rebanar([1, 2, 3, 4], 1)[0];", 2},
+        {"longitud(rebanar([1, 2, 3], 5));", 0},
+        {"longitud(rebanar([1, 2, 3], 2, 1));", 0},
+        {"concatenar([1, 2], [], [3])[2];", 3},
+        {"longitud(concatenar());", 0}
     };
 
     eval_and_test_objects(tests);
 }
+
+TEST_CASE("Hash evaluation")
+{
+    vector<tuple<string,int>> tests {
+        {"{\"uno\": 1, \"dos\": 2}[\"dos\"]", 2},
+        {"variable clave = \"u\" + \"no\"; {\"uno\": 1}[clave]", 1},
+        {"{1: 10, 2: 20}[1 + 1]", 20},
+        {"{verdadero: 1, falso: 0}[5 > 1]", 1},
+        {"{1: 1, 1: 2}[1]", 2},
+        {"longitud({1: 1, \"1\": 2, verdadero: 3})", 3},
+        {"variable d = {}; poner(d, \"a\", 5); poner(d, \"a\", 6); d[\"a\"] + longitud(d);", 7},
+        {"variable d = {\"a\": 1}; obtener(d, \"a\");", 1},
+        {"variable d = {}; variable i = 0; mientras (i < 1000) { poner(d, i, i * 2); i = i + 1; }; d[999] + longitud(d);", 2998}
+    };
+    eval_and_test_objects(tests);
+
+    vector<tuple<string,bool>> booleans {
+        {"contiene({\"a\": 1}, \"a\")", true},
+        {"contiene({\"a\": 1}, \"b\")", false},
+        {"contiene({1: nulo}, 1)", true},
+        {"variable d = {1: 1}; eliminar(d, 1)", true},
+        {"variable d = {1: 1}; eliminar(d, 1); contiene(d, 1)", false},
+        {"eliminar({1: 1}, 2)", false}
+    };
+    eval_and_test_objects(booleans);
+
+    test_object(evaluate_tests("{1: 2}[3]"));
+    test_object(evaluate_tests("obtener({}, \"a\")"));
+    REQUIRE(evaluate_tests("{}").inspect() == "{}");
+    REQUIRE(evaluate_tests("{\"a\": [1, 2]}").inspect() == "{a: [1, 2]}");
+}
+
+TEST_CASE("Hash table keeps every key through growth and removals")
+{
+    obj::Hash hash;
+    constexpr int64_t keys = 10000;
+    for(int64_t i = 0; i < keys; i++)
+        hash.set(Value::integer(i), Value::integer(i * 3));
+    REQUIRE(hash.size() == keys);
+
+    for(int64_t i = 0; i < keys; i += 2)
+        REQUIRE(hash.remove(Value::integer(i)));
+    REQUIRE_FALSE(hash.remove(Value::integer(0)));
+    REQUIRE(hash.size() == keys / 2);
+
+    for(int64_t i = 0; i < keys; i++)
+    {
+        auto value = hash.get(Value::integer(i));
+        if(i % 2 == 0)
+            REQUIRE(value == nullptr);
+        else
+            REQUIRE(value.as_integer() == i * 3);
+    }
+
+    hash.set(Value::boolean(true), Value::integer(1));
+    REQUIRE(hash.get(Value::boolean(true)).as_integer() == 1);
+    REQUIRE(hash.get(Value::boolean(false)) == nullptr);
+}
+
+TEST_CASE("Array evaluation")
+{
+    vector<tuple<string,string>> tests {
+        {"[1, 2 * 2, 3 + 3]", "[1, 4, 6]"},
+        {"[]", "[]"},
+        {"[\"a\", verdadero, nulo, [1]]", "[a, verdadero, nulo, [1]]"},
+        {"variable a = [1, 2]; agregar(a, 3); a", "[1, 2, 3]"},
+        {"variable a = [1, 2]; variable b = concatenar(a, a); agregar(a, 3); b", "[1, 2, 1, 2]"}
+    };
+    for(auto& t : tests)
+    {
+        INFO(get<0>(t));
+        REQUIRE(evaluate_tests(get<0>(t)).inspect() == get<1>(t));
+    }
+
+    vector<tuple<string,int>> indexes {
+        {"[1, 2, 3][0]", 1},
+        {"[1, 2, 3][2]", 3},
+        {"variable i = 0; [1][i];", 1},
+        {"[1, 2, 3][1 + 1];", 3},
+        {"variable a = [1, 2, 3]; a[2];", 3},
+        {"variable a = [1, 2, 3]; a[0] + a[1] + a[2];", 6},
+        {"variable a = [1, 2, 3]; variable i = a[0]; a[i]", 2},
+        {"[[1, 2], [3, 4]][1][0]", 3},
+        {"variable primero = procedimiento(a) { a[0] }; primero([7, 8]);", 7}
+    };
+    eval_and_test_objects(indexes);
+
+    test_object(evaluate_tests("[1, 2, 3][3]"));
+    test_object(evaluate_tests("[1, 2, 3][-1]"));
+}
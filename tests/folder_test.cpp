@@ -0,0 +1,134 @@
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../object.h"
+#include "../folder.h"
+#include "../interpreter.h"
+#include "catch2/catch.hpp"
+#include <string>
+using namespace std;
+using namespace ast;
+
+static constexpr Engine engines[] = {Engine::TREE_WALKER, Engine::STACK, Engine::VM};
+
+// The expression of the only statement of source, once folded.
+static Expression* fold_expression(const string& source, Programs_Guard& guard)
+{
+    auto program = guard.new_program(source);
+    Lexer lexer(program->source);
+    Parser parser(lexer, program->arena);
+    program->statements = parser.parse_program();
+    REQUIRE(parser.errors().empty());
+    REQUIRE(program->statements.size() == 1);
+
+    ConstantFolder().fold(program);
+    auto statement = program->statements[0];
+    REQUIRE(statement->type() == Node::ExpressionStatement);
+    return static_cast<ExpressionStatement*>(statement)->expression;
+}
+
+TEST_CASE("Operations on literals are folded", "[folder]")
+{
+    struct Test
+    {
+        string input;
+        Node type;
+        string expected;
+    };
+
+    Test tests[] = {
+        {"60 * 60 * 24;", Node::Integer, "86400"},
+        {"(5 + 10 * 2 + 15 / 3) * 2 + -10;", Node::Integer, "50"},
+        {"1 - 5;", Node::Integer, "-4"},
+        {"-(2 * 3);", Node::Integer, "-6"},
+        {"1 < 2;", Node::Boolean, "verdadero"},
+        {"!verdadero == falso;", Node::Boolean, "verdadero"},
+        {"!5;", Node::Boolean, "falso"},
+        {"\"ho\" + \"la\" == \"hola\";", Node::Boolean, "verdadero"},
+        {"\"ho\" + \"la\";", Node::StringLiteral, "hola"},
+    };
+
+    for(const auto& test : tests)
+    {
+        Programs_Guard guard;
+        auto expression = fold_expression(test.input, guard);
+        REQUIRE(expression->type() == test.type);
+        REQUIRE(expression->to_string() == test.expected);
+    }
+}
+
+TEST_CASE("Expressions that could fail are left alone", "[folder]")
+{
+    const string tests[] = {
+        "5 / 0;",
+        "-verdadero;",
+        "verdadero + falso;",
+        "\"a\" - \"b\";",
+        "\"a\" < \"b\";",
+        "1 + x;",
+    };
+
+    for(const auto& test : tests)
+    {
+        Programs_Guard guard;
+        auto expression = fold_expression(test, guard);
+        REQUIRE(expression->type() != Node::Integer);
+        REQUIRE(expression->type() != Node::Boolean);
+        REQUIRE(expression->type() != Node::StringLiteral);
+    }
+}
+
+TEST_CASE("Folding reaches into functions and loops", "[folder]")
+{
+    Programs_Guard guard;
+    auto expression = fold_expression("procedimiento(x) { mientras (x < 2 * 3) { x = x + 1 * 1; }; regresa [2 + 2, x]; };", guard);
+    REQUIRE(expression->to_string() == "procedimiento(x){mientras (x < 6) x = (x + 1)regresa [4, x];}");
+}
+
+TEST_CASE("String literals evaluate to the same object", "[folder]")
+{
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine});
+        auto program = interpreter.compile("\"hola\";");
+        REQUIRE(program);
+
+        auto first = interpreter.run(program);
+        auto second = interpreter.run(program);
+        REQUIRE(first.as<obj::String>()->value() == "hola");
+        REQUIRE(first == second);
+        REQUIRE(interpreter.memory().stats(static_cast<size_t>(obj::ObjectType::STRING)).allocations == 0);
+    }
+}
+
+TEST_CASE("Equal string literals share one object", "[folder]")
+{
+    Programs_Guard guard;
+    auto expression = fold_expression("[\"lunes\", \"lu\" + \"nes\", \"martes\", \"lunes\"];", guard);
+    REQUIRE(expression->type() == Node::ArrayLiteral);
+    const auto& elements = static_cast<ArrayLiteral*>(expression)->elements;
+
+    auto object = [&](size_t i) { return static_cast<StringLiteral*>(elements.at(i))->object; };
+    REQUIRE(object(0) == object(1));
+    REQUIRE(object(0) == object(3));
+    REQUIRE(object(0) != object(2));
+
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine});
+        REQUIRE(interpreter.run("\"lunes\" == \"lunes\";") == obj::Value::boolean(true));
+        REQUIRE(interpreter.run("\"lunes\" != \"lunes\";") == obj::Value::boolean(false));
+        REQUIRE(interpreter.run("variable h = \"lu\"; h + \"nes\" == \"lunes\";") == obj::Value::boolean(true));
+    }
+}
+
+TEST_CASE("Folded programs give the results they gave before", "[folder]")
+{
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine});
+        REQUIRE(interpreter.run("60 * 60 * 24;").as_integer() == 86400);
+        REQUIRE(interpreter.run("longitud(\"ho\" + \"la\");").as_integer() == 4);
+        REQUIRE(interpreter.run("-verdadero;").type() == obj::ObjectType::ERROR);
+    }
+}
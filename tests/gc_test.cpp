@@ -0,0 +1,170 @@
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../object.h"
+#include "../evaluator.h"
+#include "../gc.h"
+#include "catch2/catch.hpp"
+#include <memory>
+#include <string>
+using namespace std;
+using obj::Object;
+using ast::Program;
+
+obj::Value evaluate_gc_tests(const string& str, Environment* env)
+{
+    // the functions defined by the program keep pointers into its tree
+    static ast::Programs_Guard guard;
+    auto program = guard.new_program(str);
+    Lexer lexer(program->source);
+    Parser parser(lexer, program->arena);
+    program->statements = parser.parse_program();
+    REQUIRE(parser.errors().empty());
+    return evaluate(program, env);
+}
+
+TEST_CASE("Unreachable objects are reclaimed", "[gc]")
+{
+    gc::heap().set_threshold(4096);
+    auto env = make_unique<Environment>();
+    gc::RootScope roots(gc::heap(), env.get());
+    evaluate_gc_tests("                                 \
+        variable cuenta = procedimiento(n) {            \
+            si (n == 0) { regresa 0; }                  \
+            variable basura = procedimiento() { n };       \
+            regresa cuenta(n - 1);                      \
+        };", env.get());
+
+    auto before = gc::heap().collections();
+    auto result = evaluate_gc_tests("cuenta(2000);", env.get());
+    REQUIRE(result.as_integer() == 0);
+    REQUIRE(gc::heap().collections() > before);
+
+    // the REPL environment and its functions survive every collection
+    result = evaluate_gc_tests("cuenta(10);", env.get());
+    REQUIRE(result.as_integer() == 0);
+}
+
+TEST_CASE("Heap stays flat under sustained load", "[gc]")
+{
+    gc::heap().set_threshold(4096);
+    auto env = make_unique<Environment>();
+    gc::RootScope roots(gc::heap(), env.get());
+    evaluate_gc_tests("                                 \
+        variable suma = procedimiento(n) {              \
+            si (n == 0) { regresa 0; }                  \
+            regresa n + suma(n - 1);                    \
+        };", env.get());
+
+    evaluate_gc_tests("suma(100);", env.get());
+    gc::heap().collect();
+    auto live = gc::heap().live_objects();
+
+    for(int i = 0; i < 50; i++)
+        evaluate_gc_tests("suma(100);", env.get());
+    gc::heap().collect();
+
+    REQUIRE(gc::heap().live_objects() <= live);
+}
+
+TEST_CASE("Arrays keep their elements alive", "[gc]")
+{
+    gc::heap().set_threshold(1024);
+    auto env = make_unique<Environment>();
+    gc::RootScope roots(gc::heap(), env.get());
+    evaluate_gc_tests("                                 \
+        variable a = [];                                \
+        variable i = 0;                                 \
+        mientras (i < 500) {                            \
+            agregar(a, \"elemento\");                   \
+            agregar(a, [i]);                            \
+            i = i + 1;                                  \
+        };", env.get());
+
+    gc::heap().collect();
+    auto result = evaluate_gc_tests("longitud(a[998]) + a[999][0];", env.get());
+    REQUIRE(result.as_integer() == 8 + 499);
+}
+
+TEST_CASE("Hashes keep their keys and values alive", "[gc]")
+{
+    gc::heap().set_threshold(1024);
+    auto env = make_unique<Environment>();
+    gc::RootScope roots(gc::heap(), env.get());
+    evaluate_gc_tests("                                 \
+        variable d = {};                                \
+        variable i = 0;                                 \
+        mientras (i < 500) {                            \
+            poner(d, \"clave\" + \"s\", [i]);           \
+            poner(d, i, \"valor\");                     \
+            i = i + 1;                                  \
+        };", env.get());
+
+    gc::heap().collect();
+    auto result = evaluate_gc_tests("d[\"claves\"][0] + longitud(d[499]) + longitud(d);", env.get());
+    REQUIRE(result.as_integer() == 499 + 5 + 501);
+}
+
+TEST_CASE("Closures keep their environment alive", "[gc]")
+{
+    gc::heap().set_threshold(1024);
+    auto env = make_unique<Environment>();
+    gc::RootScope roots(gc::heap(), env.get());
+    evaluate_gc_tests("                                 \
+        variable sumador = procedimiento(x) {           \
+            regresa procedimiento(y) { regresa x + y; };\
+        };                                              \
+        variable suma_dos = sumador(2);", env.get());
+
+    gc::heap().collect();
+    auto result = evaluate_gc_tests("suma_dos(5);", env.get());
+    REQUIRE(result.as_integer() == 7);
+}
+
+TEST_CASE("The heap counts what it makes by kind", "[gc]")
+{
+    gc::Heap heap;
+    gc::HeapScope scope(heap);
+    auto env = make_unique<Environment>();
+    gc::RootScope roots(heap, env.get());
+    evaluate_gc_tests("                                 \
+        variable cadena = procedimiento(n) {            \
+            variable vacia = procedimiento() { n };     \
+            si (n == 0) { regresa \"\"; }               \
+            regresa cadena(n - 1) + \"a\";              \
+        };                                              \
+        variable guardada = cadena(10);", env.get());
+
+    // the calls make closures, so their environments are on the heap
+    auto strings = heap.stats(static_cast<size_t>(obj::ObjectType::STRING));
+    auto environments = heap.stats(obj::ENVIRONMENT_KIND);
+    REQUIRE(strings.allocations >= 21);
+    REQUIRE(strings.bytes == strings.allocations * sizeof(obj::String));
+    REQUIRE(environments.allocations == 11);
+    REQUIRE(heap.peak_bytes() >= heap.bytes_allocated());
+
+    heap.collect();
+    REQUIRE(heap.stats(static_cast<size_t>(obj::ObjectType::STRING)).live == 1);
+    REQUIRE(heap.stats(obj::ENVIRONMENT_KIND).live == 0);
+    REQUIRE(heap.stats(static_cast<size_t>(obj::ObjectType::FUNCTION)).live == 1);
+}
+
+TEST_CASE("Calls that make no closures take their environments from a pool", "[gc]")
+{
+    gc::Heap heap;
+    gc::HeapScope scope(heap);
+    heap.set_threshold(1024);
+    auto env = make_unique<Environment>();
+    gc::RootScope roots(heap, env.get());
+    auto result = evaluate_gc_tests("                   \
+        variable cuenta = procedimiento(n, acc) {       \
+            si (n == 0) { regresa acc; }                \
+            variable resto = cuenta(n - 1, acc + \"a\");  \
+            regresa resto;                              \
+        };                                              \
+        longitud(cuenta(200, \"\"));", env.get());
+
+    REQUIRE(result.as_integer() == 200);
+    REQUIRE(heap.collections() > 0);
+    REQUIRE(heap.stats(obj::ENVIRONMENT_KIND).allocations == 0);
+}
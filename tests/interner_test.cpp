@@ -0,0 +1,95 @@
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../interner.h"
+#include "../interpreter.h"
+#include "../resolver.h"
+#include "../symbol_table.h"
+#include "catch2/catch.hpp"
+#include <span>
+#include <string>
+using namespace std;
+using obj::Value;
+
+static constexpr Engine engines[] = {Engine::TREE_WALKER, Engine::STACK, Engine::VM};
+
+TEST_CASE("The same text interns to the same symbol", "[interner]")
+{
+    Interner names;
+    string text = "contador";
+
+    auto first = names.intern("contador");
+    auto second = names.intern(text);
+    auto other = names.intern("suma");
+
+    REQUIRE(first == second);
+    REQUIRE(first != other);
+    REQUIRE(first.view() == "contador");
+    REQUIRE(names.size() == 2);
+
+    REQUIRE(names.find("suma") == other);
+    REQUIRE_FALSE(names.find("desconocido"));
+    REQUIRE(names.size() == 2);
+}
+
+TEST_CASE("Interners hand out their own symbols", "[interner]")
+{
+    Interner first;
+    Interner second;
+    REQUIRE(first.intern("x") != second.intern("x"));
+    REQUIRE(first.intern("x").view() == second.intern("x").view());
+}
+
+TEST_CASE("The resolver gives every occurrence of a name its symbol", "[interner]")
+{
+    ast::Programs_Guard guard;
+    auto program = guard.new_program("variable x = 1; x = x + 1; variable f = procedimiento(x) { x };");
+    Lexer lexer(program->source);
+    Parser parser(lexer, program->arena);
+    program->statements = parser.parse_program();
+    REQUIRE(parser.errors().empty());
+
+    Interner names;
+    current_interner = &names;
+    SymbolTable globals;
+    Resolver(globals).resolve(program);
+    current_interner = nullptr;
+
+    auto let_statement = static_cast<ast::LetStatement*>(program->statements.at(0));
+    auto assign = static_cast<ast::AssignStatement*>(program->statements.at(1));
+    auto sum = static_cast<ast::Infix*>(assign->value);
+    auto function = static_cast<ast::Function*>(static_cast<ast::LetStatement*>(program->statements.at(2))->value);
+
+    auto x = names.find("x");
+    REQUIRE(x);
+    REQUIRE(let_statement->name->symbol == x);
+    REQUIRE(assign->name->symbol == x);
+    REQUIRE(static_cast<ast::Identifier*>(sum->left)->symbol == x);
+    REQUIRE(function->parameters.at(0)->symbol == x);
+
+    size_t slot = 0;
+    REQUIRE(globals.find(x, slot));
+    REQUIRE(globals.name(slot) == x);
+    REQUIRE(globals.find(names.find("f"), slot));
+}
+
+TEST_CASE("Interpreters keep their own names", "[interner]")
+{
+    for(auto engine : engines)
+    {
+        Interpreter first({engine});
+        Interpreter second({engine});
+        first.define("triple", [](span<const Value> args, const int) -> Value {
+            return Value::integer(args[0].as_integer() * 3);
+        });
+
+        REQUIRE(first.run("variable n = triple(2); n;").as_integer() == 6);
+        REQUIRE(second.run("variable n = longitud(\"abcd\"); n;").as_integer() == 4);
+        REQUIRE(second.run("triple(2);").type() == obj::ObjectType::ERROR);
+
+        first.set("host", Value::integer(7));
+        REQUIRE(first.run("host + n;").as_integer() == 13);
+        REQUIRE(second.get("host") == nullptr);
+        REQUIRE(first.get("n").as_integer() == 6);
+    }
+}
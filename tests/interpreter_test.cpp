@@ -0,0 +1,211 @@
+#include "../interpreter.h"
+#include "../object.h"
+#include "catch2/catch.hpp"
+#include <atomic>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+using obj::Value;
+
+static constexpr Engine engines[] = {Engine::TREE_WALKER, Engine::STACK, Engine::VM};
+
+TEST_CASE("Interpreters keep their own globals", "[interpreter]")
+{
+    for(auto engine : engines)
+    {
+        Interpreter first({engine});
+        Interpreter second({engine});
+
+        first.run("variable a = 5;");
+        second.run("variable a = 10;");
+
+        REQUIRE(first.run("a;").as_integer() == 5);
+        REQUIRE(second.run("a;").as_integer() == 10);
+
+        first.run("variable h = \"ho\"; variable s = h + \"la\";");
+        REQUIRE(first.memory().live_objects() > second.memory().live_objects());
+    }
+}
+
+TEST_CASE("Interpreter parse errors", "[interpreter]")
+{
+    Interpreter interpreter;
+
+    REQUIRE(interpreter.run("variable = 5;") == nullptr);
+    REQUIRE_FALSE(interpreter.errors().empty());
+
+    REQUIRE(interpreter.run("1 + 1;").as_integer() == 2);
+    REQUIRE(interpreter.errors().empty());
+}
+
+TEST_CASE("Interpreters keep their own builtins", "[interpreter]")
+{
+    Interpreter custom;
+    Interpreter standard;
+    custom.builtins().define("doble", [](span<const Value> args, const int) -> Value {
+        return Value::integer(args[0].as_integer() * 2);
+    });
+
+    REQUIRE(custom.run("doble(21);").as_integer() == 42);
+    REQUIRE(standard.run("doble(21);").type() == obj::ObjectType::ERROR);
+    REQUIRE(standard.run("longitud(\"abc\");").as_integer() == 3);
+}
+
+TEST_CASE("Interpreters run in parallel threads", "[interpreter]")
+{
+    static constexpr int THREADS = 8;
+    const string source =
+        "variable fib = procedimiento(n) { si (n < 2) { regresa n; } regresa fib(n - 1) + fib(n - 2); };"
+        "variable cadena = procedimiento(n) { si (n < 1) { regresa \"\"; } regresa cadena(n - 1) + \"a\"; };"
+        "longitud(cadena(100)) + fib(18);";
+
+    for(auto engine : engines)
+    {
+        atomic<int> passed = 0;
+        vector<thread> threads;
+        for(int i = 0; i < THREADS; i++)
+            threads.emplace_back([&] {
+                // a small threshold makes every thread collect while the others allocate
+                Interpreter interpreter({engine, StackEvaluator::DEFAULT_MAX_DEPTH, 1024});
+                auto result = interpreter.run(source);
+                if(result && result.is_integer() && result.as_integer() == 100 + 2584 && interpreter.memory().collections() > 0)
+                    passed++;
+            });
+        for(auto& t : threads)
+            t.join();
+
+        REQUIRE(passed == THREADS);
+    }
+}
+
+TEST_CASE("Compiled programs run many times", "[interpreter]")
+{
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine});
+        interpreter.run("variable total = 0;");
+        auto program = interpreter.compile("total = total + paso; total;");
+        REQUIRE(program != nullptr);
+
+        for(int i = 1; i <= 3; i++)
+        {
+            interpreter.set("paso", Value::integer(i));
+            REQUIRE(interpreter.run(program).as_integer() == i * (i + 1) / 2);
+        }
+        REQUIRE(interpreter.get("total").as_integer() == 6);
+        REQUIRE(interpreter.get("desconocida") == nullptr);
+
+        REQUIRE(interpreter.compile("variable = 5;") == nullptr);
+        REQUIRE_FALSE(interpreter.errors().empty());
+    }
+}
+
+TEST_CASE("Host values survive collections", "[interpreter]")
+{
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine, StackEvaluator::DEFAULT_MAX_DEPTH, 64});
+        interpreter.set("nombre", interpreter.make_string("mundo"));
+        for(int i = 0; i < 100; i++)
+            interpreter.make_string("basura");
+        interpreter.define("saludo", [&](span<const Value> args, const int) -> Value {
+            return interpreter.make_string("hola " + args[0].as<obj::String>()->value());
+        });
+
+        auto result = interpreter.run("saludo(nombre);");
+        REQUIRE(result.type() == obj::ObjectType::STRING);
+        REQUIRE(result.as<obj::String>()->value() == "hola mundo");
+        REQUIRE(interpreter.memory().collections() > 0);
+    }
+}
+
+TEST_CASE("estadisticas reports the heap of its interpreter", "[interpreter]")
+{
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine});
+        interpreter.run("variable h = \"ho\"; variable s = h + \"la\"; variable a = [1, 2];");
+
+        REQUIRE(interpreter.run("estadisticas()[\"ARRAY\"][\"asignaciones\"];").as_integer() == 1);
+        REQUIRE(interpreter.run("estadisticas()[\"STRING\"][\"vivos\"];").as_integer() >= 1);
+        REQUIRE(interpreter.run("estadisticas()[\"pico\"] > 0;") == Value::boolean(true));
+        REQUIRE(interpreter.run("estadisticas(1);").type() == obj::ObjectType::ERROR);
+    }
+}
+
+TEST_CASE("Returning from a function allocates no objects", "[interpreter]")
+{
+    const string source =
+        "variable identidad = procedimiento(x) { regresa x; };\n"
+        "variable primero = procedimiento(n) { mientras (verdadero) { si (n > 0) { regresa n; } n = n + 1; } };\n"
+        "variable cola = procedimiento(n) { si (n == 0) { regresa 0; } regresa cola(n - 1); };\n"
+        "identidad(1) + primero(-3) + cola(50);";
+
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine});
+        auto program = interpreter.compile(source);
+        REQUIRE(program);
+        REQUIRE(interpreter.run(program).as_integer() == 2);
+
+        // environments are what the calls themselves need
+        size_t objects = 0;
+        for(size_t kind = 0; kind < obj::ENVIRONMENT_KIND; kind++)
+            objects += interpreter.memory().stats(kind).allocations;
+        // the three functions
+        REQUIRE(objects == 3);
+    }
+}
+
+TEST_CASE("Only calls that make closures put environments on the heap", "[interpreter]")
+{
+    const string source =
+        "variable fib = procedimiento(n) { si (n < 2) { regresa n; } regresa fib(n - 1) + fib(n - 2); };\n"
+        "variable sumador = procedimiento(x) { regresa procedimiento(y) { regresa x + y; }; };\n"
+        "fib(10) + sumador(3)(4) + sumador(5)(6);";
+
+    for(auto engine : engines)
+    {
+        Interpreter interpreter({engine});
+        REQUIRE(interpreter.run(source).as_integer() == 55 + 7 + 11);
+        // one for each call to sumador, none for fib or the closures it returned
+        REQUIRE(interpreter.memory().stats(obj::ENVIRONMENT_KIND).allocations == 2);
+    }
+}
+
+TEST_CASE("Repeated concatenation builds ropes that read as flat text", "[interpreter]")
+{
+    const string source =
+        "variable repite = procedimiento(s, n) { si (n == 0) { regresa s; } regresa repite(s + \"abcd\", n - 1); };\n"
+        "variable antes = procedimiento(s, n) { si (n == 0) { regresa s; } regresa antes(\"abcd\" + s, n - 1); };\n"
+        "variable largo = repite(\"\", 2000);\n";
+    const string expected = [] {
+        string text;
+        for(int i = 0; i < 2000; i++)
+            text += "abcd";
+        return text;
+    }();
+
+    for(auto engine : engines)
+    {
+        // a small threshold collects while the ropes are being built
+        Interpreter interpreter({engine, StackEvaluator::DEFAULT_MAX_DEPTH, 1024});
+        REQUIRE(interpreter.run(source) != nullptr);
+        REQUIRE(interpreter.memory().collections() > 0);
+
+        auto largo = interpreter.get("largo").as<obj::String>();
+        REQUIRE(largo->is_rope());
+        REQUIRE(interpreter.run("longitud(largo);").as_integer() == 8000);
+        REQUIRE(largo->is_rope());
+
+        REQUIRE(interpreter.run("largo == antes(\"\", 2000);") == Value::boolean(true));
+        REQUIRE_FALSE(largo->is_rope());
+        REQUIRE(largo->value() == expected);
+
+        REQUIRE(interpreter.run("variable d = {}; poner(d, repite(\"x\", 20), 1); d[\"x\" + repite(\"\", 20)];").as_integer() == 1);
+        REQUIRE(interpreter.run("repite(\"x\", 20) == repite(\"y\", 20);") == Value::boolean(false));
+    }
+}
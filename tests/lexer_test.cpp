@@ -216,6 +216,76 @@ TEST_CASE("Control statement", "[lexer]")
     REQUIRE(tokens == expected_tokens);
 }
 
+TEST_CASE("Loop statement", "[lexer]")
+{
+    string src = "mientras (i < 10) { i = i + 1; }";
+    Lexer lexer(src);
+    vector<Token> tokens;
+    for(size_t i = 0; i <= 13; i++)
+        tokens.push_back(lexer.next_token());
+
+    vector<Token> expected_tokens {
+        Token(TokenType::WHILE, "mientras", 1, 8),
+        Token(TokenType::LPAREN, "("),
+        Token(TokenType::IDENT, "i"),
+        Token(TokenType::LT, "<"),
+        Token(TokenType::INT, "10", 1, 2),
+        Token(TokenType::RPAREN, ")"),
+        Token(TokenType::LBRACE, "{"),
+        Token(TokenType::IDENT, "i"),
+        Token(TokenType::ASSIGN, "="),
+        Token(TokenType::IDENT, "i"),
+        Token(TokenType::PLUS, "+"),
+        Token(TokenType::INT, "1"),
+        Token(TokenType::SEMICOLON, ";"),
+        Token(TokenType::RBRACE, "}")
+    };
+
+    REQUIRE(tokens == expected_tokens);
+}
+
+TEST_CASE("Brackets", "[lexer]")
+{
+    string src = "[1, 2][0];";
+    Lexer lexer(src);
+    vector<Token> tokens;
+    for(size_t i = 0; i <= 8; i++)
+        tokens.push_back(lexer.next_token());
+
+    vector<Token> expected_tokens {
+        Token(TokenType::LBRACKET, "["),
+        Token(TokenType::INT, "1"),
+        Token(TokenType::COMMA, ","),
+        Token(TokenType::INT, "2"),
+        Token(TokenType::RBRACKET, "]"),
+        Token(TokenType::LBRACKET, "["),
+        Token(TokenType::INT, "0"),
+        Token(TokenType::RBRACKET, "]"),
+        Token(TokenType::SEMICOLON, ";")
+    };
+
+    REQUIRE(tokens == expected_tokens);
+}
+
+TEST_CASE("Colon", "[lexer]")
+{
+    string src = "{\"uno\": 1}";
+    Lexer lexer(src);
+    vector<Token> tokens;
+    for(size_t i = 0; i <= 4; i++)
+        tokens.push_back(lexer.next_token());
+
+    vector<Token> expected_tokens {
+        Token(TokenType::LBRACE, "{"),
+        Token(TokenType::STRING, "uno", 1, 3),
+        Token(TokenType::COLON, ":"),
+        Token(TokenType::INT, "1"),
+        Token(TokenType::RBRACE, "}")
+    };
+
+    REQUIRE(tokens == expected_tokens);
+}
+
 TEST_CASE("Two character operator", "[lexer]")
 {
     string src = "10 == 10; 10 != 9;";
@@ -61,13 +61,14 @@ TEST_CASE("Parse program", "[parser]")
     Lexer lexer(str);
     Parser parser(lexer);
     Program program(parser.parse_program());
+    Arena arena;
     Program expected_program{ vector<Statement*> {
-                                new LetStatement(
+                                arena.make<LetStatement>(
                                     Token(TokenType::LET, "variable", 1, 8),
-                                    new Identifier(
+                                    arena.make<Identifier>(
                                         Token(TokenType::IDENT, "x"),
                                         "x"),
-                                    new Expression(Token(TokenType::INT, "5"))
+                                    arena.make<Expression>(Token(TokenType::INT, "5"))
                                 )
     }};
 
@@ -179,6 +180,7 @@ TEST_CASE("Prefix expression", "[parser]")
     test_program_statements(parser, program, 3);
 
     const array<const string, 3> op { "!", "-", "!" };
+    const array<const ast::Operator, 3> decoded_op { ast::Operator::NEGATION, ast::Operator::MINUS, ast::Operator::NEGATION };
     const array<const string, 3> right_expression { "5", "15", "verdadero" };
 
     for(size_t i = 0; i < 3; i++)
@@ -187,6 +189,7 @@ TEST_CASE("Prefix expression", "[parser]")
         auto prefix_expression = static_cast<Prefix*>(expression_statement->expression);
 
         REQUIRE(prefix_expression->token_literal() == op.at(i));
+        REQUIRE(prefix_expression->op == decoded_op.at(i));
         REQUIRE(prefix_expression->right->token_literal() == right_expression.at(i));
     }
 }
@@ -227,6 +230,17 @@ TEST_CASE("Infix expression", "[parser]")
         {true, "!=", false}
     };
 
+    const array<const ast::Operator, 8> decoded_operators {
+        ast::Operator::PLUS,
+        ast::Operator::MINUS,
+        ast::Operator::MULTIPLICATION,
+        ast::Operator::DIVISION,
+        ast::Operator::GT,
+        ast::Operator::LT,
+        ast::Operator::EQ,
+        ast::Operator::NOT_EQ
+    };
+
     for(size_t i = 0; i < 8; i++)
     {
         auto expression_statement = static_cast<ExpressionStatement*>(program.statements.at(i));
@@ -237,6 +251,7 @@ TEST_CASE("Infix expression", "[parser]")
             get<0>(tuple),
             get<1>(tuple),
             get<2>(tuple));
+        REQUIRE(static_cast<Infix*>(expression_statement->expression)->op == decoded_operators.at(i));
     }
 
     size_t tuple_count = 0;
@@ -296,7 +311,9 @@ TEST_CASE("Operator precedence", "[parser]")
         {"a + suma(b * c) + d;", "((a + suma((b * c))) + d)", 1},
         {"suma(a, b, 1, 2 * 3, 4 + 5, suma(6, 7 * 8));",
             "suma(a, b, 1, (2 * 3), (4 + 5), suma(6, (7 * 8)))", 1},
-        {"suma(a + b + c * d / f + g);", "suma((((a + b) + ((c * d) / f)) + g))", 1}
+        {"suma(a + b + c * d / f + g);", "suma((((a + b) + ((c * d) / f)) + g))", 1},
+        {"a * [1, 2, 3, 4][b * c] * d;", "((a * ([1, 2, 3, 4][(b * c)])) * d)", 1},
+        {"suma(a * b[2], b[1], 2 * [1, 2][1]);", "suma((a * (b[2])), (b[1]), (2 * ([1, 2][1])))", 1}
     };
 
     for(size_t i = 0; i < test_sources.size(); i++)
@@ -355,6 +372,25 @@ TEST_CASE("Else statement", "[parser]")
     test_literal(alternative_statement->expression, "w");
 }
 
+TEST_CASE("While expression", "[parser]")
+{
+    string str = "mientras (x < y) { z }";
+    Lexer lexer(str);
+    Parser parser(lexer);
+    Program program(parser.parse_program());
+
+    test_program_statements(parser, program);
+
+    auto loop = static_cast<While*>(static_cast<ExpressionStatement*>(program.statements.at(0))->expression);
+    REQUIRE(loop->type() == ast::Node::While);
+    test_infix_expression(loop->condition, "x", "<", "y");
+
+    REQUIRE(loop->body->statements.size() == 1);
+    auto body_statement = static_cast<ExpressionStatement*>(loop->body->statements.at(0));
+    test_literal(body_statement->expression, "z");
+    REQUIRE(program.to_string() == "mientras (x < y) z");
+}
+
 TEST_CASE("Funtion literal", "[parser]")
 {
     string str = "procedimiento(x, y) { x + y}";
@@ -421,6 +457,76 @@ TEST_CASE("Call expression", "[parser]")
     test_infix_expression(call->arguments.at(2), 4, "+", 5);
 }
 
+TEST_CASE("Array literal", "[parser]")
+{
+    string str = "[1, 2 * 2, 3 + 3]; [];";
+    Lexer lexer(str);
+    Parser parser(lexer);
+    Program program(parser.parse_program());
+
+    test_program_statements(parser, program, 2);
+
+    auto array = static_cast<ArrayLiteral*>(static_cast<ExpressionStatement*>(program.statements.at(0))->expression);
+    REQUIRE(array->type() == ast::Node::ArrayLiteral);
+    REQUIRE(array->elements.size() == 3);
+    test_literal(array->elements.at(0), 1);
+    test_infix_expression(array->elements.at(1), 2, "*", 2);
+    test_infix_expression(array->elements.at(2), 3, "+", 3);
+
+    auto empty = static_cast<ArrayLiteral*>(static_cast<ExpressionStatement*>(program.statements.at(1))->expression);
+    REQUIRE(empty->elements.empty());
+}
+
+TEST_CASE("Hash literal", "[parser]")
+{
+    string str = "{\"uno\": 1, 2: 1 + 1, verdadero: x}; {};";
+    Lexer lexer(str);
+    Parser parser(lexer);
+    Program program(parser.parse_program());
+
+    test_program_statements(parser, program, 2);
+
+    auto hash = static_cast<HashLiteral*>(static_cast<ExpressionStatement*>(program.statements.at(0))->expression);
+    REQUIRE(hash->type() == ast::Node::HashLiteral);
+    REQUIRE(hash->entries.size() == 6);
+    REQUIRE(static_cast<StringLiteral*>(hash->entries.at(0))->value == "uno");
+    test_literal(hash->entries.at(1), 1);
+    test_literal(hash->entries.at(2), 2);
+    test_infix_expression(hash->entries.at(3), 1, "+", 1);
+    test_literal(hash->entries.at(4), true);
+    test_literal(hash->entries.at(5), "x");
+
+    auto empty = static_cast<HashLiteral*>(static_cast<ExpressionStatement*>(program.statements.at(1))->expression);
+    REQUIRE(empty->entries.empty());
+}
+
+TEST_CASE("Hash literal errors", "[parser]")
+{
+    for(auto source : {"{1 2}", "{1: 2 3: 4}", "{1: 2"})
+    {
+        INFO(source);
+        Lexer lexer(source);
+        Parser parser(lexer);
+        Program program(parser.parse_program());
+        REQUIRE_FALSE(parser.errors().empty());
+    }
+}
+
+TEST_CASE("Index expression", "[parser]")
+{
+    string str = "arreglo[1 + 1]";
+    Lexer lexer(str);
+    Parser parser(lexer);
+    Program program(parser.parse_program());
+
+    test_program_statements(parser, program);
+
+    auto index = static_cast<Index*>(static_cast<ExpressionStatement*>(program.statements.at(0))->expression);
+    REQUIRE(index->type() == ast::Node::Index);
+    test_literal(index->left, "arreglo");
+    test_infix_expression(index->index, 1, "+", 1);
+}
+
 TEST_CASE("String literal expression")
 {
     string str = "\"hello world!\"";
@@ -0,0 +1,75 @@
+#include "../interpreter.h"
+#include "../profiler.h"
+#include "catch2/catch.hpp"
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+using namespace std;
+
+static constexpr Engine engines[] = {Engine::TREE_WALKER, Engine::STACK, Engine::VM};
+
+TEST_CASE("Samples are counted on the current stack", "[profiler]")
+{
+    ast::Function outer(Token(TokenType::FUNCTION, "procedimiento", 1, 13));
+    ast::Function inner(Token(TokenType::FUNCTION, "procedimiento", 3, 13));
+    outer.name = "externa";
+
+    Profiler profiler(chrono::microseconds(100));
+    profiler.enter(&outer);
+    profiler.enter(&inner);
+    while(profiler.sample_count() == 0)
+    {
+        this_thread::sleep_for(chrono::milliseconds(1));
+        profiler.poll();
+    }
+    profiler.leave();
+    profiler.leave();
+    REQUIRE(profiler.depth() == 0);
+
+    ostringstream out;
+    profiler.write(out);
+    REQUIRE(out.str() == "programa;externa:1;procedimiento:3 1\n");
+}
+
+TEST_CASE("Scripts are profiled on every engine", "[profiler]")
+{
+    const string source =
+        "variable fib = procedimiento(n) { si (n < 2) { regresa n; } regresa fib(n - 1) + fib(n - 2); };\n"
+        "variable cuenta = procedimiento(n) { si (n < 1) { regresa 0; } regresa cuenta(n - 1); };\n"
+        "fib(18) + cuenta(1000);";
+
+    for(auto engine : engines)
+    {
+        Options options{engine};
+        options.profile = "perfil";
+        Interpreter interpreter(options);
+        auto program = interpreter.compile(source);
+        REQUIRE(program);
+
+        auto profiler = interpreter.profiler();
+        REQUIRE(profiler);
+        while(profiler->sample_count() < 5)
+            REQUIRE(interpreter.run(program).as_integer() == 2584);
+        REQUIRE(profiler->depth() == 0);
+
+        ostringstream out;
+        profiler->write(out);
+        REQUIRE(out.str().find("programa;fib:1;fib:1") != string::npos);
+    }
+}
+
+TEST_CASE("A run ending in an error leaves no frames behind", "[profiler]")
+{
+    for(auto engine : engines)
+    {
+        Options options{engine};
+        options.profile = "perfil";
+        Interpreter interpreter(options);
+
+        auto result = interpreter.run("variable f = procedimiento(n) { si (n < 1) { regresa -verdadero; } regresa 1 + f(n - 1); }; f(50);");
+        REQUIRE(result.type() == obj::ObjectType::ERROR);
+        REQUIRE(interpreter.profiler()->depth() == 0);
+    }
+    REQUIRE_FALSE(Interpreter().profiler());
+}
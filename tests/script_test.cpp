@@ -0,0 +1,45 @@
+#include "../script.h"
+#include "catch2/catch.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+using namespace std;
+
+static string write_script(const string& name, const string& source)
+{
+    auto path = string("lpp_script_test_") + name + ".lpp";
+    ofstream file(path, ios::binary);
+    file << source;
+    return path;
+}
+
+TEST_CASE("Multi line scripts run once", "[script]")
+{
+    auto path = write_script("ok",
+        "variable fib = procedimiento(n) {\n"
+        "    si (n < 2) { regresa n; }\n"
+        "    regresa fib(n - 1) + fib(n - 2);\n"
+        "};\n"
+        "fib(10);\n");
+
+    REQUIRE(run_script(path.c_str(), {}) == EXIT_SUCCESS);
+    REQUIRE(run_script(path.c_str(), {Engine::STACK}) == EXIT_SUCCESS);
+    REQUIRE(run_script(path.c_str(), {Engine::VM}) == EXIT_SUCCESS);
+    remove(path.c_str());
+}
+
+TEST_CASE("Script failures set the exit status", "[script]")
+{
+    auto parse_error = write_script("parse_error", "variable = 5;\n");
+    auto runtime_error = write_script("runtime_error", "variable a = 5;\n-verdadero;\na;\n");
+
+    REQUIRE(run_script(parse_error.c_str(), {}) == EXIT_FAILURE);
+    REQUIRE(run_script(runtime_error.c_str(), {}) == EXIT_FAILURE);
+    REQUIRE(run_script(runtime_error.c_str(), {Engine::STACK}) == EXIT_FAILURE);
+    REQUIRE(run_script(runtime_error.c_str(), {Engine::VM}) == EXIT_FAILURE);
+    REQUIRE(run_script("lpp_script_test_missing.lpp", {}) == EXIT_FAILURE);
+
+    remove(parse_error.c_str());
+    remove(runtime_error.c_str());
+}
@@ -0,0 +1,191 @@
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../object.h"
+#include "../evaluator.h"
+#include "../stack_evaluator.h"
+#include "catch2/catch.hpp"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace std;
+using ast::Program;
+
+Value run_stack_tests(const string& str, Environment* env, const size_t max_depth = StackEvaluator::DEFAULT_MAX_DEPTH)
+{
+    // the functions defined by the program keep pointers into its tree
+    static ast::Programs_Guard guard;
+    auto program = guard.new_program(str);
+    Lexer lexer(program->source);
+    Parser parser(lexer, program->arena);
+    program->statements = parser.parse_program();
+    REQUIRE(parser.errors().empty());
+    auto evaluated = StackEvaluator(max_depth).run(program, env);
+    REQUIRE(evaluated != nullptr);
+    return evaluated;
+}
+
+string evaluate_tree_walker(const string& str)
+{
+    Lexer lexer(str);
+    Parser parser(lexer);
+    Program program(parser.parse_program());
+    auto env = make_unique<Environment>();
+    auto evaluated = evaluate(&program, env.get());
+    REQUIRE(evaluated != nullptr);
+    return evaluated.inspect();
+}
+
+void compare_engines(const vector<string>& tests)
+{
+    for(auto& source : tests)
+    {
+        INFO(source);
+        auto env = make_unique<Environment>();
+        REQUIRE(run_stack_tests(source, env.get()).inspect() == evaluate_tree_walker(source));
+    }
+}
+
+TEST_CASE("Expressions match the tree walker", "[stack]")
+{
+    compare_engines({
+        "5",
+        "-10",
+        "2 * (5 - 3)",
+        "50 / 2 * 2 + 10",
+        "(1 < 2) == verdadero",
+        "!!nulo",
+        "nulo != 1",
+        "\"a\" + \"b\" == \"ab\"",
+        "si (verdadero) { 10 }",
+        "si (falso) { 10 }",
+        "si (1 > 2) { 10 } si_no { 20 }",
+        "9; regresa 3 * 6; 9;",
+        "si (10 > 1) { si (20 > 10) { regresa 1; } regresa 0; }"
+    });
+}
+
+TEST_CASE("Errors match the tree walker", "[stack]")
+{
+    compare_engines({
+        "5 + verdadero; 9;",
+        "-verdadero",
+        "si (10 > 7) {\n regresa verdadero + falso;\n }",
+        "\"foo\" - \"bar\";",
+        "longitud(1);",
+        "longitud(\"uno\", \"dos\");",
+        "variable f = procedimiento(x) { x }; f(1, 2);",
+        "variable f = procedimiento() { 5 + verdadero; 10 }; f();",
+        "5(1)"
+    });
+}
+
+TEST_CASE("Functions match the tree walker", "[stack]")
+{
+    compare_engines({
+        "variable identidad = procedimiento(x) { x }; identidad(5);",
+        "variable suma = procedimiento(x, y) { regresa x + y; }; suma(5 + 5, suma(10, 10));",
+        "procedimiento(x) { x }(5)",
+        "variable sumador = procedimiento(x) { regresa procedimiento(y) { regresa x + y; }; };"
+            "variable suma_dos = sumador(2); suma_dos(5);",
+        "variable fib = procedimiento(n) { si (n < 2) { regresa n; } regresa fib(n - 1) + fib(n - 2); }; fib(15);",
+        "variable saludo = procedimiento(nombre) { regresa \"Hola \" + nombre + \"!\"; }; saludo(\"David\")",
+        "variable x = 1; variable f = procedimiento() { variable y = x; variable x = 2; regresa y + x; }; f();",
+        "variable f = procedimiento() { variable g = procedimiento() { z }; variable z = 3; g() }; f();",
+        "a = 5; b = a; c = a + b + 5; c;"
+    });
+}
+
+TEST_CASE("Tail calls do not add frames", "[stack]")
+{
+    compare_engines({
+        "variable par = procedimiento(n) { si (n == 0) { regresa verdadero; } regresa impar(n - 1); };"
+            "variable impar = procedimiento(n) { si (n == 0) { regresa falso; } regresa par(n - 1); }; par(20001);",
+        "variable f = procedimiento(n, g) { si (n == 0) { regresa g(); } regresa f(n - 1, procedimiento() { n }); };"
+            "f(3, procedimiento() { 0 });",
+        "variable f = procedimiento(s) { regresa longitud(s); 5 }; f(\"abc\");",
+        "variable f = procedimiento(x) { regresa f(); }; f(1);"
+    });
+
+    auto env = make_unique<Environment>();
+    auto evaluated = run_stack_tests(
+        "variable contar = procedimiento(n, acc) { si (n == 0) { regresa acc; } regresa contar(n - 1, acc + n); };"
+        "contar(200000, 0);", env.get(), 10);
+    REQUIRE(evaluated.as_integer() == 20000100000);
+}
+
+TEST_CASE("Loops match the tree walker", "[stack]")
+{
+    compare_engines({
+        "variable i = 0; variable suma = 0; mientras (i < 100) { i = i + 1; suma = suma + i; }; suma;",
+        "variable i = 0; mientras (i < 10) { i = i + 1; si (i == 5) { regresa i * 10; } }; 0;",
+        "variable f = procedimiento(n) { variable i = 0; mientras (verdadero) { si (i == n) { regresa i; } i = i + 1; } }; f(7);",
+        "mientras (falso) { 1 }",
+        "variable i = 0; mientras (i < 3) { i = i + 1; }",
+        "mientras (1 + verdadero) { 1 }; 5;",
+        "variable i = 0; mientras (i < 3) { i = i + 1; -verdadero; }; 5;",
+        "variable f = procedimiento() { mientras (1 + verdadero) { 1 }; 5 }; f();",
+        "variable f = procedimiento(n) { mientras (verdadero) { si (n == 0) { regresa 0; } regresa f(n - 1); } }; f(1000);"
+    });
+}
+
+TEST_CASE("Arrays match the tree walker", "[stack]")
+{
+    compare_engines({
+        "[1, 2 * 2, 3 + 3]",
+        "[]",
+        "[[1, 2], [3, 4]][1][0]",
+        "[1, 2, 3][3]",
+        "[1, 2][verdadero]",
+        "5[0]",
+        "[1, 2 + verdadero, 3]",
+        "variable a = [1, 2]; agregar(a, 3); a",
+        "variable a = []; variable i = 0; mientras (i < 100) { agregar(a, i * i); i = i + 1; }; a[99] + longitud(a);",
+        "rebanar(concatenar([1, 2], [3, 4]), 1, 3)",
+        "variable primero = procedimiento(a) { a[0] }; primero([7, 8]);",
+        "[procedimiento() { 1 }(), si (falso) { 2 }, 3]"
+    });
+}
+
+TEST_CASE("Hashes match the tree walker", "[stack]")
+{
+    compare_engines({
+        "{\"uno\": 1, \"dos\": 2}[\"dos\"]",
+        "{1: 10, 2: 20, verdadero: 30, \"1\": 40}",
+        "{[1]: 2}",
+        "{1: 2 + verdadero}",
+        "{1: 2}[3]",
+        "variable d = {}; variable i = 0; mientras (i < 100) { poner(d, i, i * 2); i = i + 1; }; d[99] + longitud(d);",
+        "variable d = {\"a\": 1}; eliminar(d, \"a\"); contiene(d, \"a\");",
+        "variable f = procedimiento(d, k) { d[k] }; f({\"k\": [1, 2]}, \"k\");",
+        "{si (falso) { 1 }: procedimiento() { 2 }()}"
+    });
+}
+
+TEST_CASE("Deep recursion does not use the native stack", "[stack]")
+{
+    auto env = make_unique<Environment>();
+    auto evaluated = run_stack_tests(
+        "variable cuenta = procedimiento(n) { si (n == 0) { regresa 0; } regresa 1 + cuenta(n - 1); };"
+        "cuenta(50000);", env.get());
+    REQUIRE(evaluated.as_integer() == 50000);
+}
+
+TEST_CASE("Calls deeper than the maximum depth are an error", "[stack]")
+{
+    auto env = make_unique<Environment>();
+    run_stack_tests("variable cuenta = procedimiento(n) { si (n == 0) { regresa 0; } regresa 1 + cuenta(n - 1); };", env.get());
+
+    // cuenta(n) nests n + 1 calls
+    auto evaluated = run_stack_tests("cuenta(99);", env.get(), 100);
+    REQUIRE(evaluated.as_integer() == 99);
+
+    evaluated = run_stack_tests("cuenta(100);", env.get(), 100);
+    REQUIRE(evaluated.type() == ObjectType::ERROR);
+    REQUIRE(evaluated.as<obj::Error>()->message == "Se excedió la profundidad máxima de 100 llamadas cerca de la línea 1");
+
+    // the globals are left as they were
+    evaluated = run_stack_tests("cuenta(10);", env.get(), 100);
+    REQUIRE(evaluated.as_integer() == 10);
+}
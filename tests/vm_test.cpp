@@ -0,0 +1,194 @@
+#include "../lexer.h"
+#include "../parser.h"
+#include "../ast.h"
+#include "../object.h"
+#include "../evaluator.h"
+#include "../vm.h"
+#include "catch2/catch.hpp"
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+using namespace std;
+using obj::Object;
+using ast::Program;
+
+obj::Value run_vm_tests(const string& str, VM& vm)
+{
+    // the functions compiled from the program keep pointers into its tree
+    static ast::Programs_Guard guard;
+    auto program = guard.new_program(str);
+    Lexer lexer(program->source);
+    Parser parser(lexer, program->arena);
+    program->statements = parser.parse_program();
+    REQUIRE(parser.errors().empty());
+    auto evaluated = vm.run(program);
+    REQUIRE(evaluated != nullptr);
+    return evaluated;
+}
+
+string evaluate_tree_walker(const string& str)
+{
+    Lexer lexer(str);
+    Parser parser(lexer);
+    Program program(parser.parse_program());
+    auto env = make_unique<Environment>();
+    auto evaluated = evaluate(&program, env.get());
+    REQUIRE(evaluated != nullptr);
+    return evaluated.inspect();
+}
+
+void compare_engines(const vector<string>& tests)
+{
+    for(auto& source : tests)
+    {
+        INFO(source);
+        VM vm;
+        REQUIRE(run_vm_tests(source, vm).inspect() == evaluate_tree_walker(source));
+    }
+}
+
+TEST_CASE("Integer and boolean expressions", "[vm]")
+{
+    compare_engines({
+        "5",
+        "-10",
+        "5 - 10",
+        "-5 / 2",
+        "2 * (5 - 3)",
+        "50 / 2 * 2 + 10",
+        "1 < 2",
+        "1 > 2",
+        "1 != 2",
+        "(1 < 2) == verdadero",
+        "verdadero != falso",
+        "!5",
+        "!!nulo",
+        "nulo == nulo",
+        "nulo != 1",
+        "\"a\" == \"a\"",
+        "\"a\" != \"b\""
+    });
+}
+
+TEST_CASE("Conditionals and returns", "[vm]")
+{
+    compare_engines({
+        "si (verdadero) { 10 }",
+        "si (falso) { 10 }",
+        "si (1 > 2) { 10 } si_no { 20 }",
+        "regresa 10; 9;",
+        "9; regresa 3 * 6; 9;",
+        "si (10 > 1) { si (20 > 10) { regresa 1; } regresa 0; }"
+    });
+}
+
+TEST_CASE("Errors match the tree walker", "[vm]")
+{
+    compare_engines({
+        "5 + verdadero; 9;",
+        "-verdadero",
+        "5; verdadero - falso; 10;",
+        "si (10 > 7) {\n regresa verdadero + falso;\n }",
+        "si (5 < 2) {\n regresa 1;\n } si_no {\n regresa verdadero / falso;\n }",
+        "\"foo\" - \"bar\";",
+        "longitud(1);",
+        "longitud(\"uno\", \"dos\");",
+        "variable f = procedimiento(x) { x }; f(1, 2);",
+        "variable f = procedimiento() { 5 + verdadero; 10 }; f();",
+        "5(1)"
+    });
+}
+
+TEST_CASE("Functions and closures", "[vm]")
+{
+    compare_engines({
+        "variable identidad = procedimiento(x) { x }; identidad(5);",
+        "variable suma = procedimiento(x, y) { regresa x + y; }; suma(5 + 5, suma(10, 10));",
+        "procedimiento(x) { x }(5)",
+        "variable sumador = procedimiento(x) { regresa procedimiento(y) { regresa x + y; }; };"
+            "variable suma_dos = sumador(2); suma_dos(5);",
+        "variable fib = procedimiento(n) { si (n < 2) { regresa n; } regresa fib(n - 1) + fib(n - 2); }; fib(15);",
+        "variable saludo = procedimiento(nombre) { regresa \"Hola \" + nombre + \"!\"; }; saludo(\"David\")",
+        "longitud(\"Hola mundo\")",
+        "variable x = 1; variable f = procedimiento() { variable y = x; variable x = 2; regresa y + x; }; f();",
+        "variable f = procedimiento() { variable g = procedimiento() { z }; variable z = 3; g() }; f();",
+        "a = 5; b = a; c = a + b + 5; c;",
+        "variable f = procedimiento(){}; f"
+    });
+}
+
+TEST_CASE("Tail calls", "[vm]")
+{
+    compare_engines({
+        "variable contar = procedimiento(n, acc) { si (n == 0) { regresa acc; } regresa contar(n - 1, acc + n); };"
+            "contar(200000, 0);",
+        "variable par = procedimiento(n) { si (n == 0) { regresa verdadero; } regresa impar(n - 1); };"
+            "variable impar = procedimiento(n) { si (n == 0) { regresa falso; } regresa par(n - 1); }; par(20001);",
+        "variable f = procedimiento(n, g) { si (n == 0) { regresa g(); } regresa f(n - 1, procedimiento() { n }); };"
+            "f(3, procedimiento() { 0 });",
+        "variable f = procedimiento(s) { regresa longitud(s); 5 }; f(\"abc\");",
+        "variable f = procedimiento(x) { regresa f(); }; f(1);",
+        "regresa longitud(\"abc\"); 5;"
+    });
+}
+
+TEST_CASE("Loops match the tree walker", "[vm]")
+{
+    compare_engines({
+        "variable i = 0; variable suma = 0; mientras (i < 100) { i = i + 1; suma = suma + i; }; suma;",
+        "variable i = 0; mientras (i < 10) { i = i + 1; si (i == 5) { regresa i * 10; } }; 0;",
+        "variable f = procedimiento(n) { variable i = 0; mientras (verdadero) { si (i == n) { regresa i; } i = i + 1; } }; f(7);",
+        "mientras (falso) { 1 }",
+        "variable i = 0; mientras (i < 3) { i = i + 1; }",
+        "mientras (1 + verdadero) { 1 }; 5;",
+        "variable i = 0; mientras (i < 3) { i = i + 1; -verdadero; }; 5;",
+        "variable f = procedimiento() { mientras (1 + verdadero) { 1 }; 5 }; f();",
+        "variable i = 0; mientras (i < 3) { i = i + 1; }; mientras (i < 6) { i = i + 1; }; i;"
+    });
+}
+
+TEST_CASE("Arrays match the tree walker", "[vm]")
+{
+    compare_engines({
+        "[1, 2 * 2, 3 + 3]",
+        "[]",
+        "[[1, 2], [3, 4]][1][0]",
+        "[1, 2, 3][3]",
+        "[1, 2][verdadero]",
+        "5[0]",
+        "[1, 2 + verdadero, 3]",
+        "variable a = [1, 2]; agregar(a, 3); a",
+        "variable a = []; variable i = 0; mientras (i < 100) { agregar(a, i * i); i = i + 1; }; a[99] + longitud(a);",
+        "rebanar(concatenar([1, 2], [3, 4]), 1, 3)",
+        "variable primero = procedimiento(a) { a[0] }; primero([7, 8]);",
+        "rebanar([1]);"
+    });
+}
+
+TEST_CASE("Hashes match the tree walker", "[vm]")
+{
+    compare_engines({
+        "{\"uno\": 1, \"dos\": 2}[\"dos\"]",
+        "{1: 10, 2: 20, verdadero: 30, \"1\": 40}",
+        "{[1]: 2}",
+        "{1: 2 + verdadero}",
+        "{1: 2}[3]",
+        "variable d = {}; variable i = 0; mientras (i < 100) { poner(d, i, i * 2); i = i + 1; }; d[99] + longitud(d);",
+        "variable d = {\"a\": 1}; eliminar(d, \"a\"); contiene(d, \"a\");",
+        "variable f = procedimiento(d, k) { d[k] }; f({\"k\": [1, 2]}, \"k\");"
+    });
+}
+
+TEST_CASE("Globals persist between programs", "[vm]")
+{
+    VM vm;
+    run_vm_tests("variable a = 5;", vm);
+    run_vm_tests("variable doble = procedimiento(x) { regresa 2 * x + b; };", vm);
+    run_vm_tests("variable b = 1;", vm);
+    auto evaluated = run_vm_tests("doble(a);", vm);
+    REQUIRE(evaluated.as_integer() == 11);
+
+    evaluated = run_vm_tests("c", vm);
+    REQUIRE(evaluated == _NULL);
+}
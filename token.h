@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <array>
 #include <fmt/format.h>
 #include "utils.h"
@@ -37,10 +38,14 @@ enum class TokenType
     RETURN,
     EQ,
     NOT_EQ,
-    STRING
+    STRING,
+    WHILE,
+    LBRACKET,
+    RBRACKET,
+    COLON
 };
 
-static constexpr std::array<NameValuePair<TokenType>, 29> tokens_enums_strings {{
+static constexpr std::array<NameValuePair<TokenType>, 33> tokens_enums_strings {{
     {TokenType::ASSIGN, "ASSIGN"},
     {TokenType::COMMA, "COMMA\t"},
     {TokenType::_EOF, "EOF\t"},
@@ -69,20 +74,26 @@ static constexpr std::array<NameValuePair<TokenType>, 29> tokens_enums_strings {
     {TokenType::RETURN, "RETURN"},
     {TokenType::EQ, "EQ\t"},
     {TokenType::NOT_EQ, "NOT_EQ"},
-    {TokenType::STRING, "STRING"}
+    {TokenType::STRING, "STRING"},
+    {TokenType::WHILE, "WHILE\t"},
+    {TokenType::LBRACKET, "LBRACKET"},
+    {TokenType::RBRACKET, "RBRACKET"},
+    {TokenType::COLON, "COLON\t"}
 }};
 
 class Token
 {
 public:
-    std::string literal;
+    // points into the source text, which must outlive the token
+    std::string_view literal;
     TokenType token_type;
     int line;
 
     Token() = default;
     Token(const TokenType t, const char* l, const int line = 1, const std::size_t s = 1) : literal(l, s), token_type(t), line(line) {}
-    Token(const TokenType t, const char* b, const char* e, const int line = 1) : literal(b, e), token_type(t), line(line) {}
-    Token(const TokenType t, const std::string& s, const int line = 1) : literal(s), token_type(t), line(line) {}
+    Token(const TokenType t, const char* b, const char* e, const int line = 1)
+        : literal(b, static_cast<std::size_t>(e - b)), token_type(t), line(line) {}
+    Token(const TokenType t, std::string_view s, const int line = 1) : literal(s), token_type(t), line(line) {}
 
     bool operator==(const Token& r) const noexcept
     {
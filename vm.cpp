@@ -0,0 +1,389 @@
+#include "vm.h"
+#include "ast.h"
+#include "builtin.h"
+#include "code.h"
+#include "evaluator.h"
+#include "gc.h"
+#include "object.h"
+#include "profiler.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+#include <fmt/format.h>
+
+using namespace std;
+using code::OpCode;
+using code::read_operand;
+
+VM::VM() : globals(nullptr, &compiler.global_symbols()) {}
+
+Value VM::run(ast::Program* program)
+{
+    if(program->statements.empty())
+        return nullptr;
+
+    auto& main = compiled[program];
+    if(!main)
+        main = compiler.compile(program);
+    globals.grow();
+
+    gc::RootScope roots(gc::heap(), this);
+    ProfileScope profile(current_profiler);
+    frames.push_back({main, main->instructions.data(), stack.size(), &globals});
+    return execute();
+}
+
+void VM::trace(gc::Heap& heap)
+{
+    heap.mark(&globals);
+    for(auto value : stack)
+        heap.mark(value.object());
+    for(auto& frame : frames)
+        heap.mark(frame.env);
+}
+
+Value VM::execute()
+{
+    const auto entry = frames.size();
+    const auto profiler = current_profiler;
+    auto function = frames.back().function;
+    auto ip = frames.back().ip;
+    auto env = frames.back().env;
+
+    // pops the current frame, returns true once the frame run started with is gone
+    auto leave = [&](Value result) -> bool
+    {
+        stack.resize(frames.back().base);
+        pool.release(frames.back().env);
+        frames.pop_back();
+        if(frames.size() < entry)
+        {
+            stack.push_back(result);
+            return true;
+        }
+        stack.push_back(result);
+        if(profiler) [[unlikely]]
+            profiler->leave();
+        function = frames.back().function;
+        ip = frames.back().ip;
+        env = frames.back().env;
+        return false;
+    };
+
+    for(;;)
+    {
+        auto start = ip;
+        auto op = static_cast<OpCode>(*ip++);
+
+        switch (op) {
+            case OpCode::CONSTANT:
+                stack.push_back(function->constants[read_operand<uint32_t>(ip)]);
+                ip += sizeof(uint32_t);
+                break;
+
+            case OpCode::_TRUE:
+                stack.push_back(TRUE);
+                break;
+
+            case OpCode::_FALSE:
+                stack.push_back(FALSE);
+                break;
+
+            case OpCode::_NULL:
+                stack.push_back(_NULL);
+                break;
+
+            case OpCode::POP:
+                stack.pop_back();
+                break;
+
+            case OpCode::CHECK:
+            case OpCode::POP_CHECK:
+                {
+                    // every statement and every loop iteration is a sampling point
+                    if(profiler) [[unlikely]]
+                        profiler->poll();
+                    auto value = stack.back();
+                    if(value.type() != ObjectType::ERROR)
+                    {
+                        if(op == OpCode::POP_CHECK)
+                            stack.pop_back();
+                        break;
+                    }
+                    if(leave(value))
+                    {
+                        stack.pop_back();
+                        return value;
+                    }
+                    break;
+                }
+
+            case OpCode::ADD:
+            case OpCode::SUB:
+            case OpCode::MUL:
+            case OpCode::DIV:
+            case OpCode::EQ:
+            case OpCode::NOT_EQ:
+            case OpCode::LT:
+            case OpCode::GT:
+                {
+                    auto right = stack.back();
+                    auto left = stack[stack.size() - 2];
+                    Value result;
+
+                    if(left.is_integer() && right.is_integer())
+                    {
+                        auto left_value = left.as_integer();
+                        auto right_value = right.as_integer();
+                        switch (op) {
+                            case OpCode::ADD: result = Value::integer(left_value + right_value); break;
+                            case OpCode::SUB: result = Value::integer(left_value - right_value); break;
+                            case OpCode::MUL: result = Value::integer(left_value * right_value); break;
+                            case OpCode::DIV: result = Value::integer(left_value / right_value); break;
+                            case OpCode::EQ: result = to_boolean_object(left_value == right_value); break;
+                            case OpCode::NOT_EQ: result = to_boolean_object(left_value != right_value); break;
+                            case OpCode::LT: result = to_boolean_object(left_value < right_value); break;
+                            default: result = to_boolean_object(left_value > right_value); break;
+                        }
+                    }
+                    else
+                    {
+                        auto infix_op = static_cast<ast::Operator>(static_cast<int>(op) - static_cast<int>(OpCode::ADD));
+                        auto line = function->lines[static_cast<size_t>(start - function->instructions.data())];
+                        result = evaluate_infix_expression(infix_op, left, right, line);
+                    }
+
+                    stack.pop_back();
+                    stack.back() = result;
+                    break;
+                }
+
+            case OpCode::MINUS:
+                {
+                    auto line = function->lines[static_cast<size_t>(start - function->instructions.data())];
+                    stack.back() = evaluate_minus_operator_expression(stack.back(), line);
+                    break;
+                }
+
+            case OpCode::BANG:
+                stack.back() = evaluate_bang_operator_expression(stack.back());
+                break;
+
+            case OpCode::JUMP:
+                ip = function->instructions.data() + read_operand<uint32_t>(ip);
+                break;
+
+            case OpCode::JUMP_IF_FALSE:
+                {
+                    auto condition = stack.back();
+                    stack.pop_back();
+                    if(is_truthy(condition))
+                        ip += sizeof(uint32_t);
+                    else
+                        ip = function->instructions.data() + read_operand<uint32_t>(ip);
+                    break;
+                }
+
+            case OpCode::GET:
+                {
+                    auto depth = read_operand<uint16_t>(ip);
+                    auto slot = read_operand<uint16_t>(ip + sizeof(uint16_t));
+                    ip += 2 * sizeof(uint16_t);
+
+                    auto frame = env;
+                    for(uint16_t i = 0; i < depth; i++)
+                        frame = frame->outer;
+
+                    auto value = frame->slots[slot];
+                    stack.push_back(value ? value : find_hole(frame, slot));
+                    break;
+                }
+
+            case OpCode::SET:
+                env->slots[read_operand<uint16_t>(ip)] = stack.back();
+                ip += sizeof(uint16_t);
+                break;
+
+            case OpCode::GET_NAME:
+                stack.push_back(find_name(function->names[read_operand<uint32_t>(ip)]));
+                ip += sizeof(uint32_t);
+                break;
+
+            case OpCode::CLOSURE:
+                {
+                    auto fn = function->functions[read_operand<uint32_t>(ip)];
+                    ip += sizeof(uint32_t);
+                    env->captured = true;
+                    stack.push_back(gc::heap().make<obj::Closure>(fn, env));
+                    break;
+                }
+
+            case OpCode::CALL:
+            case OpCode::TAIL_CALL:
+                {
+                    auto argc = read_operand<uint16_t>(ip);
+                    ip += sizeof(uint16_t);
+                    auto base = stack.size() - argc - 1;
+                    auto callee = stack[base];
+                    auto line = function->lines[static_cast<size_t>(start - function->instructions.data())];
+
+                    if(callee.type() != ObjectType::FUNCTION)
+                    {
+                        auto result = call(callee, argc, line);
+                        stack.resize(base);
+                        stack.push_back(result);
+                        break;
+                    }
+
+                    auto closure = callee.as<obj::Closure>();
+                    auto fn = closure->function;
+                    if(fn->parameter_slots.size() != argc)
+                    {
+                        auto error = gc::heap().make<Error>(
+                            fmt::format(WRONG_ARGS,
+                                        line,
+                                        fn->parameter_slots.size(),
+                                        argc
+                        ));
+                        stack.resize(base);
+                        stack.push_back(error);
+                        break;
+                    }
+
+                    if(op == OpCode::TAIL_CALL)
+                    {
+                        // the callee takes over the frame of the function returning its result
+                        auto& current = frames.back();
+                        if(current.env->reusable_for(fn->symbols))
+                            current.env->reuse(closure->env);
+                        else
+                        {
+                            pool.release(current.env);
+                            current.env = make_environment(closure);
+                        }
+                        for(size_t i = 0; i < argc; i++)
+                            current.env->slots[fn->parameter_slots[i]] = stack[base + 1 + i];
+                        stack.resize(current.base);
+                        if(profiler) [[unlikely]]
+                            profiler->tail_call(fn->definition);
+                        current.function = fn;
+                        function = fn;
+                        ip = fn->instructions.data();
+                        env = current.env;
+                        break;
+                    }
+
+                    auto frame = make_environment(closure);
+                    for(size_t i = 0; i < argc; i++)
+                        frame->slots[fn->parameter_slots[i]] = stack[base + 1 + i];
+
+                    frames.back().ip = ip;
+                    frames.push_back({fn, fn->instructions.data(), base, frame});
+                    if(profiler) [[unlikely]]
+                        profiler->enter(fn->definition);
+                    function = fn;
+                    ip = fn->instructions.data();
+                    env = frame;
+                    break;
+                }
+
+            case OpCode::ARRAY:
+                {
+                    auto count = read_operand<uint32_t>(ip);
+                    ip += sizeof(uint32_t);
+                    // the elements stay on the stack, and so rooted, until the array holds them
+                    auto first = stack.end() - static_cast<ptrdiff_t>(count);
+                    auto result = make_array(vector<Value>(first, stack.end()));
+                    stack.resize(stack.size() - count);
+                    stack.push_back(result);
+                    break;
+                }
+
+            case OpCode::HASH:
+                {
+                    auto count = read_operand<uint32_t>(ip);
+                    ip += sizeof(uint32_t);
+                    auto line = function->lines[static_cast<size_t>(start - function->instructions.data())];
+                    // the keys and values stay on the stack, and so rooted, until the table holds them
+                    auto result = make_hash(span<const Value>(stack.data() + stack.size() - count, count), line);
+                    stack.resize(stack.size() - count);
+                    stack.push_back(result);
+                    break;
+                }
+
+            case OpCode::INDEX:
+                {
+                    auto index = stack.back();
+                    auto left = stack[stack.size() - 2];
+                    auto line = function->lines[static_cast<size_t>(start - function->instructions.data())];
+                    auto result = evaluate_index_expression(left, index, line);
+                    stack.pop_back();
+                    stack.back() = result;
+                    break;
+                }
+
+            case OpCode::RETURN:
+                {
+                    auto result = stack.back();
+                    if(leave(result))
+                    {
+                        stack.pop_back();
+                        return result;
+                    }
+                    break;
+                }
+        }
+    }
+}
+
+obj::Environment* VM::make_environment(obj::Closure* closure)
+{
+    auto fn = closure->function;
+    if(needs_heap_environment(fn->definition))
+        return gc::heap().make<obj::Environment>(closure->env, fn->symbols);
+    return pool.acquire(closure->env, fn->symbols);
+}
+
+// Calls anything that is not a compiled function: builtins, or reports the
+// same error the tree walker does for values that are not callable.
+Value VM::call(Value callee, const size_t argc, const int line)
+{
+    if(callee.type() == ObjectType::BUILTIN)
+    {
+        return callee.as<obj::Builtin>()->fn(span<const Value>(stack).last(argc), line);
+    }
+
+    return gc::heap().make<Error>(
+        fmt::format(NOT_A_FUNCTION,
+                    callee.type_string(),
+                    line
+    ));
+}
+
+// A slot is empty when it is read before the statement declaring it ran,
+// in which case the tree walker would have kept looking in the outer scopes.
+Value VM::find_hole(obj::Environment* frame, const size_t slot) const
+{
+    auto name = frame->symbols->name(slot);
+    auto value = frame->outer ? frame->outer->find(name) : Value(nullptr);
+    if(value)
+        return value;
+
+    if(auto builtin = builtins().find(name))
+        return builtin;
+    return _NULL;
+}
+
+Value VM::find_name(const Symbol name) const
+{
+    auto value = globals.find(name);
+    if(value)
+        return value;
+
+    if(auto builtin = builtins().find(name))
+        return builtin;
+    return _NULL;
+}
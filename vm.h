@@ -0,0 +1,51 @@
+#ifndef VM_H
+#define VM_H
+#include "ast.h"
+#include "code.h"
+#include "compiler.h"
+#include "gc.h"
+#include "object.h"
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Stack based alternative to the tree walking evaluate(). A VM keeps its
+// globals between calls to run, the same way the REPL keeps its Environment.
+// As with evaluate(), a program must outlive the functions it defines, since
+// their scopes are the SymbolTables stored in its tree.
+class VM : public gc::Collectable
+{
+private:
+    struct CallFrame
+    {
+        const code::CompiledFunction* function;
+        const std::uint8_t* ip;
+        std::size_t base;
+        obj::Environment* env;
+    };
+
+    Compiler compiler;
+    // a program run again reuses its bytecode
+    std::unordered_map<const ast::Program*, const code::CompiledFunction*> compiled;
+    obj::Environment globals;
+    std::vector<obj::Value> stack;
+    std::vector<CallFrame> frames;
+    obj::EnvironmentPool pool;
+
+    obj::Value execute();
+    obj::Environment* make_environment(obj::Closure*);
+    obj::Value call(obj::Value, const std::size_t, const int);
+    obj::Value find_hole(obj::Environment*, const std::size_t) const;
+    obj::Value find_name(const Symbol) const;
+
+public:
+    VM();
+    VM(const VM&) = delete;
+    VM& operator=(const VM&) = delete;
+    obj::Value run(ast::Program*);
+    obj::Environment& environment() { return globals; }
+    void trace(gc::Heap&) override;
+};
+
+#endif // VM_H